@@ -0,0 +1,103 @@
+/**
+ * @file      151.smc.c
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br
+ *
+ * @version   1.0
+ * @date      Sat, 17 Oct 2026 10:12:40 -0300
+ * @brief     It is a simple main function that runs code it rewrites across a page boundary.
+ *
+ * @attention Copyright (C) 2002-2026 --- The ArchC Team
+ * 
+ * This program is free software; you can redistribute it and/or modify 
+ * it under the terms of the GNU General Public License as published by 
+ * the Free Software Foundation; either version 2 of the License, or 
+ * (at your option) any later version. 
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the 
+ * GNU General Public License for more details. 
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* The file begin.h is included if compiler flag -DBEGINCODE is used */
+#ifdef BEGINCODE
+#include "begin.h"
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* Simulators track written code in 4 KiB pages */
+#define PAGE_SIZE 4096
+
+/* Bytes copied from each function, more than any of them takes */
+#define CODE_SIZE 128
+
+typedef int (*function)(void);
+
+int retone(void);
+int rettwo(void);
+void copy(function source);
+
+/* The copies start 8 bytes before the second page, so every copy
+   writes the instructions on both sides of the page boundary */
+unsigned char code[3 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+function copied = (function) (code + PAGE_SIZE - 8);
+
+int main() {
+  
+  int tmp;
+  
+  copy(retone);
+  tmp=copied();
+  /* Before tmp must be 1 */ tmp=0;
+  
+  copy(rettwo);
+  tmp=copied();
+  /* Before tmp must be 2 */ tmp=0;
+  
+  copy(retone);
+  tmp=copied();
+  /* Before tmp must be 1 */ tmp=0;
+  
+  return 0; 
+  /* Return 0 only */
+}
+
+/* The file end.h is included if compiler flag -DENDCODE is used */
+#ifdef ENDCODE
+#include "end.h"
+#endif
+
+int retone(void) {
+  return(1);
+}
+
+int rettwo(void) {
+  return(2);
+}
+
+void copy(function source) {
+  unsigned char *from = (unsigned char *) source;
+  unsigned char *to = (unsigned char *) copied;
+  int i;
+  
+#ifdef __linux__
+  /* Native runs, used as reference, must be allowed to execute it */
+  mprotect(code, sizeof(code), PROT_READ | PROT_WRITE | PROT_EXEC);
+#endif
+  
+  for (i = 0; i < CODE_SIZE; i++)
+    to[i] = from[i];
+}
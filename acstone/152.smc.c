@@ -0,0 +1,138 @@
+/**
+ * @file      152.smc.c
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br
+ *
+ * @version   1.0
+ * @date      Sat, 17 Oct 2026 10:12:40 -0300
+ * @brief     It is a simple main function that runs functions it rewrites in place.
+ *
+ * @attention Copyright (C) 2002-2026 --- The ArchC Team
+ * 
+ * This program is free software; you can redistribute it and/or modify 
+ * it under the terms of the GNU General Public License as published by 
+ * the Free Software Foundation; either version 2 of the License, or 
+ * (at your option) any later version. 
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the 
+ * GNU General Public License for more details. 
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* The file begin.h is included if compiler flag -DBEGINCODE is used */
+#ifdef BEGINCODE
+#include "begin.h"
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* Simulators track written code in 4 KiB pages */
+#define PAGE_SIZE 4096
+
+/* Compiled simulators translate the image in regions of 512 bytes */
+#define REGION_SIZE 512
+
+typedef int (*function)(void);
+
+int patched(void);
+int retone(void);
+int rettwo(void);
+void patch(function source);
+int patch_here(function source);
+int patched_here(void);
+void unprotect(unsigned char *to);
+
+/* patched is part of the program image, so simulators that translate
+   the image ahead of time must drop their translation of it */
+int main() {
+  
+  int tmp;
+  
+  tmp=patched();
+  /* Before tmp must be 0 */ tmp=0;
+  
+  patch(rettwo);
+  tmp=patched();
+  /* Before tmp must be 2 */ tmp=0;
+  
+  patch(retone);
+  tmp=patched();
+  /* Before tmp must be 1 */ tmp=0;
+  
+  tmp=patch_here(rettwo);
+  /* Before tmp must be 2 */ tmp=0;
+  
+  tmp=patch_here(retone);
+  /* Before tmp must be 1 */ tmp=0;
+  
+  return 0; 
+  /* Return 0 only */
+}
+
+/* The file end.h is included if compiler flag -DENDCODE is used */
+#ifdef ENDCODE
+#include "end.h"
+#endif
+
+/* patch_here rewrites patched_here and calls it without leaving their
+   region: the region must be left before the call, as its translation of
+   patched_here is stale */
+int __attribute__ ((aligned (REGION_SIZE))) patch_here(function source) {
+  unsigned char *from = (unsigned char *) source;
+  unsigned char *to = (unsigned char *) patched_here;
+  int size = (unsigned char *) retone - (unsigned char *) patched;
+  int i;
+  
+  unprotect(to);
+  for (i = 0; i < size; i++)
+    to[i] = from[i];
+  return patched_here();
+}
+
+/* patched_here, patched, retone and rettwo have the same size */
+int patched_here(void) {
+  return(0);
+}
+
+int patched(void) {
+  return(0);
+}
+
+int retone(void) {
+  return(1);
+}
+
+int rettwo(void) {
+  return(2);
+}
+
+void patch(function source) {
+  unsigned char *from = (unsigned char *) source;
+  unsigned char *to = (unsigned char *) patched;
+  int size = (unsigned char *) retone - (unsigned char *) patched;
+  int i;
+  
+  unprotect(to);
+  for (i = 0; i < size; i++)
+    to[i] = from[i];
+}
+
+void unprotect(unsigned char *to) {
+#ifdef __linux__
+  /* Native runs, used as reference, must be allowed to write it */
+  mprotect((void *) ((unsigned long) to & ~(PAGE_SIZE - 1)), 2 * PAGE_SIZE,
+           PROT_READ | PROT_WRITE | PROT_EXEC);
+#endif
+}
@@ -0,0 +1,106 @@
+/**
+ * @file      153.jit.c
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br
+ *
+ * @version   1.0
+ * @date      Sat, 17 Oct 2026 10:12:40 -0300
+ * @brief     It is a simple main function that runs a hot loop copied out of the program.
+ *
+ * @attention Copyright (C) 2002-2026 --- The ArchC Team
+ * 
+ * This program is free software; you can redistribute it and/or modify 
+ * it under the terms of the GNU General Public License as published by 
+ * the Free Software Foundation; either version 2 of the License, or 
+ * (at your option) any later version. 
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the 
+ * GNU General Public License for more details. 
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with this program; if not, write to the Free Software 
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* The file begin.h is included if compiler flag -DBEGINCODE is used */
+#ifdef BEGINCODE
+#include "begin.h"
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* Bytes copied from the function, more than it takes */
+#define CODE_SIZE 256
+
+/* Iterations of the loop in each call */
+#define LOOP_SIZE 1000000
+
+typedef int (*function)(int);
+
+int sum(int n);
+int run(int calls);
+void copy(function source);
+
+/* The copy is outside the program image, so compiled simulators
+   interpret it, or compile it at run time once it gets hot */
+unsigned char code[CODE_SIZE] __attribute__ ((aligned (64)));
+function copied = (function) code;
+
+int main() {
+  
+  int tmp;
+  
+  copy(sum);
+  tmp=run(10);
+  /* Before tmp must be 20000000 */ tmp=0;
+  
+  return 0; 
+  /* Return 0 only */
+}
+
+/* The file end.h is included if compiler flag -DENDCODE is used */
+#ifdef ENDCODE
+#include "end.h"
+#endif
+
+int sum(int n) {
+  int result = 0;
+  int i;
+  
+  for (i = 0; i < n; i++)
+    result = result + 2;
+  return(result);
+}
+
+int run(int calls) {
+  int result = 0;
+  int i;
+  
+  for (i = 0; i < calls; i++)
+    result = result + copied(LOOP_SIZE);
+  return(result);
+}
+
+void copy(function source) {
+  unsigned char *from = (unsigned char *) source;
+  unsigned char *to = (unsigned char *) copied;
+  int i;
+  
+#ifdef __linux__
+  /* Native runs, used as reference, must be allowed to execute it */
+  mprotect((void *) ((unsigned long) code & ~4095UL), 2 * 4096,
+           PROT_READ | PROT_WRITE | PROT_EXEC);
+#endif
+  
+  for (i = 0; i < CODE_SIZE; i++)
+    to[i] = from[i];
+}
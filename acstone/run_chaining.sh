@@ -0,0 +1,60 @@
+#!/bin/bash
+
+if test ! $# -eq 3 || test "$1" == "--help"
+then
+    echo "This program checks that block chaining does not change the execution" 1>&2
+    echo "of each program: both simulators must be generated with acsim --checkpoint," 1>&2
+    echo "CHAINED_SIMULATOR also with --block-chaining" 1>&2
+    echo "Use: $0 ARCH SIMULATOR CHAINED_SIMULATOR" 1>&2
+    exit 1
+fi
+
+ARCH=$1
+SIMULATOR=$2
+CHAINED_SIMULATOR=$3
+FAILED=0
+
+# The chained run must retire the same number of instructions, print the
+# same output and save the same state halfway and one instruction before
+# the end
+for I in `ls *.${ARCH}`
+do
+  COUNT=`${SIMULATOR} --load=${I} 2>&1 >/dev/null | sed -n 's/.*instructions executed: *\([0-9]*\).*/\1/p'`
+  if test -z "${COUNT}"
+  then
+    echo "${I}: simulator failed" 1>&2
+    FAILED=1
+    continue
+  fi
+
+  RESULT=ok
+  for AT in $((COUNT / 2)) $((COUNT - 1))
+  do
+    rm -f ${I}.ckpt ${I}.chained.ckpt
+    ${SIMULATOR} --load=${I} --checkpoint=${I}.ckpt --checkpoint-at=${AT} > ${I}.plain.out 2> ${I}.plain.err
+    ${CHAINED_SIMULATOR} --load=${I} --checkpoint=${I}.chained.ckpt --checkpoint-at=${AT} > ${I}.chained.out 2> ${I}.chained.err
+
+    CHAINED_COUNT=`sed -n 's/.*instructions executed: *\([0-9]*\).*/\1/p' ${I}.chained.err`
+    if test "${COUNT}" != "${CHAINED_COUNT}"
+    then
+      RESULT="${CHAINED_COUNT} instructions chained, ${COUNT} expected"
+    elif ! cmp -s ${I}.plain.out ${I}.chained.out
+    then
+      RESULT="output differs"
+    elif ! cmp -s ${I}.ckpt ${I}.chained.ckpt
+    then
+      RESULT="state differs after ${AT} instructions"
+    fi
+    test "${RESULT}" != ok && break
+  done
+
+  if test "${RESULT}" == ok
+  then
+    echo "${I}: ok"
+  else
+    echo "${I}: ${RESULT}" 1>&2
+    FAILED=1
+  fi
+done
+
+exit ${FAILED}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+if test ! $# -eq 2 || test "$1" == "--help"
+then
+    echo "This program checks that two models of an architecture execute each" 1>&2
+    echo "program the same way: COSIM_SIMULATOR runs a reference and a candidate" 1>&2
+    echo "model in lockstep (see ac_cosim.H), both generated with acsim --cosim" 1>&2
+    echo "--checkpoint, and passes its options to both" 1>&2
+    echo "Use: $0 ARCH COSIM_SIMULATOR" 1>&2
+    exit 1
+fi
+
+ARCH=$1
+COSIM_SIMULATOR=$2
+FAILED=0
+
+# On a mismatch the harness bisects down to the first divergent
+# instruction, reported with its count and address
+for I in `ls *.${ARCH}`
+do
+  ${COSIM_SIMULATOR} --load=${I} > ${I}.cosim.out 2> ${I}.cosim.err
+  STATUS=$?
+
+  MATCHED=`sed -n 's/.*co-simulation: the models matched over \([0-9]*\) instructions.*/\1/p' ${I}.cosim.err`
+  DIVERGED=`sed -n 's/.*co-simulation: first divergent instruction: \(.*\)/\1/p' ${I}.cosim.err`
+  if test -n "${MATCHED}" && test ${STATUS} -eq 0
+  then
+    echo "${I}: ok (${MATCHED} instructions)"
+    continue
+  fi
+
+  if test -n "${DIVERGED}"
+  then
+    RESULT="first divergent instruction ${DIVERGED}"
+  else
+    RESULT=`sed -n 's/.*ERROR: co-simulation: //p' ${I}.cosim.err | head -n 1`
+    test -z "${RESULT}" && RESULT="simulator failed"
+  fi
+  echo "${I}: ${RESULT}" 1>&2
+  FAILED=1
+done
+
+exit ${FAILED}
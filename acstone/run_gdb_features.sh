@@ -0,0 +1,87 @@
+#!/bin/bash
+
+if test ! $# -eq 2 || test "$1" == "--help"
+then
+    echo "This program checks that a simulator generated with acsim -gdb" 1>&2
+    echo "advertises its target description and serves target.xml" 1>&2
+    echo "SIMULATOR must wait for GDB at port 5000, as the generated main does" 1>&2
+    echo "Use: $0 ARCH SIMULATOR" 1>&2
+    exit 1
+fi
+
+ARCH=$1
+SIMULATOR=$2
+PORT=5000
+
+# Reads a packet from the stub into REPLY and acknowledges it
+reply()
+{
+  local C
+
+  read -r -d '#' -u 3 REPLY || return 1
+  read -r -n 2 -u 3 C || return 1
+  printf '+' >&3
+  REPLY=${REPLY#*\$}
+}
+
+# Sends a packet to the stub and reads its reply into REPLY
+packet()
+{
+  local SUM=0 C I
+
+  for (( I = 0; I < ${#1}; I++ ))
+  do
+    printf -v C '%d' "'${1:I:1}"
+    SUM=$(( (SUM + C) % 256 ))
+  done
+  printf '$%s#%02x' "$1" ${SUM} >&3
+  reply
+}
+
+${SIMULATOR} --load=000.main.${ARCH} > gdb_features.out 2>&1 &
+SIMULATOR_PID=$!
+
+for I in `seq 50`
+do
+  # command keeps a failed exec from ending the script
+  { command exec 3<>/dev/tcp/127.0.0.1/${PORT}; } 2> /dev/null && break
+  sleep 0.2
+done
+
+# The stub reports the stop before the first instruction on its own
+RESULT=ok
+if ! reply || ! packet "qSupported:xmlRegisters=i386"
+then
+  RESULT="no reply from the simulator"
+elif test "${REPLY}" == "${REPLY/qXfer:features:read+/}"
+then
+  RESULT="qSupported does not advertise the target description: ${REPLY}"
+else
+  # Read target.xml in small parts to go through the m/l continuation
+  XML=
+  OFFSET=0
+  while packet "qXfer:features:read:target.xml:`printf '%x' ${OFFSET}`,80"
+  do
+    XML="${XML}${REPLY:1}"
+    OFFSET=$(( OFFSET + ${#REPLY} - 1 ))
+    test "${REPLY:0:1}" != m && break
+  done
+  if test "${REPLY:0:1}" != l || test "${XML}" == "${XML/<\/target>/}"
+  then
+    RESULT="bad target.xml: ${REPLY}"
+  fi
+fi
+
+printf '$k#6b' >&3 2> /dev/null
+exec 3>&-
+sleep 1
+kill ${SIMULATOR_PID} 2> /dev/null
+wait ${SIMULATOR_PID} 2> /dev/null
+
+if test "${RESULT}" == ok
+then
+  echo "target description: ok"
+  exit 0
+fi
+echo "target description: ${RESULT}" 1>&2
+exit 1
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+if test ! $# -eq 1 || test "$1" == "--help"
+then
+    echo "This program checks that a compiled simulator picks up the hot loop of" 1>&2
+    echo "153.jit, which runs outside the program image, once compiled at run time" 1>&2
+    echo "SIMULATOR must be generated with accsim --jit for 153.jit" 1>&2
+    echo "Use: $0 SIMULATOR" 1>&2
+    exit 1
+fi
+
+SIMULATOR=$1
+JIT_TMPDIR=`mktemp -d`
+
+# Interpreted run, used as reference
+${SIMULATOR} > 153.jit.plain.out 2> 153.jit.plain.err
+PLAIN_STATUS=$?
+
+# A low threshold makes the loop hot long before the program ends
+TMPDIR=${JIT_TMPDIR} AC_JIT=1 AC_JIT_THRESHOLD=10 ${SIMULATOR} > 153.jit.out 2> 153.jit.err
+STATUS=$?
+
+COUNT=`sed -n 's/.*instructions executed: *\([0-9]*\).*/\1/p' 153.jit.plain.err`
+JIT_COUNT=`sed -n 's/.*instructions executed: *\([0-9]*\).*/\1/p' 153.jit.err`
+PLAIN_COMPILED=`sed -n 's/.*compiled at run time: *\([0-9]*\).*/\1/p' 153.jit.plain.err`
+COMPILED=`sed -n 's/.*compiled at run time: *\([0-9]*\).*/\1/p' 153.jit.err`
+
+RESULT=ok
+if test -z "${COUNT}" || test -z "${JIT_COUNT}"
+then
+  RESULT="simulator failed"
+elif test "${STATUS}" != "${PLAIN_STATUS}"
+then
+  RESULT="exit status ${STATUS}, ${PLAIN_STATUS} expected"
+elif test "${COUNT}" != "${JIT_COUNT}"
+then
+  RESULT="${JIT_COUNT} instructions, ${COUNT} expected"
+elif ! cmp -s 153.jit.plain.out 153.jit.out
+then
+  RESULT="output differs"
+elif test "${PLAIN_COMPILED}" != 0
+then
+  RESULT="regions compiled without AC_JIT"
+elif test -z "${COMPILED}" || test "${COMPILED}" -eq 0
+then
+  RESULT="the hot loop was not compiled"
+elif test -n "`ls -A ${JIT_TMPDIR}`"
+then
+  RESULT="files left in TMPDIR: `ls -A ${JIT_TMPDIR}`"
+fi
+rm -rf ${JIT_TMPDIR}
+
+if test "${RESULT}" == ok
+then
+  echo "153.jit: ok (${COMPILED} regions compiled)"
+  exit 0
+fi
+echo "153.jit: ${RESULT}" 1>&2
+exit 1
@@ -801,6 +801,7 @@ void accs_CreateCompsimHeader()
 {
   char filename[256];
   FILE *output;
+  extern int ac_tgt_endian;
   extern ac_decoder_full *decoder;
   extern ac_dec_field *common_instr_field_list;
 
@@ -832,6 +833,16 @@ void accs_CreateCompsimHeader()
 
   fprintf( output, "#include \"ac_storage.H\"\n");
   fprintf( output, "#include \"ac_rtld.H\"\n");
+  if (accs_HasInterp())
+    fprintf( output, "#include \"ac_decoder_rt.H\"\n");
+  if (accs_HasJit()) {
+    fprintf( output, "#include <map>\n");
+    fprintf( output, "#include <deque>\n");
+    fprintf( output, "#include <vector>\n");
+    fprintf( output, "#include <string>\n");
+    fprintf( output, "#include <sstream>\n");
+    fprintf( output, "#include <pthread.h>\n");
+  }
   fprintf( output, "\n");
  
   /*
@@ -865,7 +876,10 @@ void accs_CreateCompsimHeader()
   fprintf( output, "ac_dynlink::ac_rtld ac_dyn_loader;\n");
   fprintf( output, "} Tref;\n\n");
 
-  fprintf( output, "class %s {\n", project_name);
+  if (accs_HasInterp())
+    fprintf( output, "class %s : public ac_dec_prog_source {\n", project_name);
+  else
+    fprintf( output, "class %s {\n", project_name);
   fprintf( output, "public: \n" );
   //Function prototypes
   fprintf( output, "\n");
@@ -916,8 +930,14 @@ void accs_CreateCompsimHeader()
 		   "	    ac_stop_flag (0), \n"
 		   "	    ac_mt_endian(0),\n"
 		   "	    ac_annul_sig(0)\n"
-		   "	    { ac_instr_counter = 0; \n"
-		   "	      ac_start_addr = 0; } \n\n");
+		   "	    { ac_instr_counter = 0; \n");
+  if (accs_HasJit())
+    fprintf( output, "	      ac_jit_started = false;\n"
+                     "	      ac_jit_compiled = 0;\n");
+  fprintf( output, "	      ac_start_addr = 0; } \n\n");
+
+  if (accs_HasJit())
+    fprintf( output, "	~%s() { JitStop(); JitRelease(true); }\n\n", project_name);
 
  
   fprintf( output, "	// Timing structures.\n");
@@ -970,6 +990,91 @@ void accs_CreateCompsimHeader()
 
   fprintf( output, "\n");
 
+  //Interpreter used for code outside the compiled regions
+  if (accs_HasInterp()) {
+    COMMENT(INDENT[3], "Interpreter for code that was not compiled");
+    fprintf( output,
+             "	struct ac_interp_entry {\n"
+             "		unsigned pc;\n"
+             "		unsigned fields[AC_DEC_FIELD_NUMBER];\n"
+             "	};\n"
+             "\n"
+             "	static const unsigned AC_INTERP_CACHE_SIZE = %d;\n"
+             "	ac_interp_entry ac_interp_cache[AC_INTERP_CACHE_SIZE];  //!< Decode cache.\n"
+             "	ac_decoder_full* ac_interp_decoder;\n"
+             "	ac_Uword ac_interp_buffer[AC_MAX_BUFFER / sizeof(ac_Uword) + 1];\n"
+             "	unsigned ac_interp_pc;\n"
+             "	bool ac_region_stale[%d];  //!< Regions whose code was modified.\n"
+             "	bool ac_region_exit;  //!< Makes the running region return, set by code writes.\n"
+             "\n"
+             "	void InitInterp();\n"
+             "	void Interpret();\n"
+             "	void InterpretStep();\n"
+             "	const unsigned* InterpDecode(unsigned pc);\n"
+             "	void ac_invalidate_code(unsigned address, unsigned size);\n"
+             "	static void ac_code_write(void* proc, unsigned address, unsigned size);\n"
+             "	unsigned long long GetBits(unsigned char* buffer, int* quant, int last, int quantity, int sign);\n"
+             "	int GetBitOrder() { return %d; }\n"
+             "\n",
+             1 << INTERP_CACHE_BITS, ((prog_size_bytes-1) >> REGION_SIZE) + 1,
+             (ac_tgt_endian == 1) ? 0 : 1);
+  }
+
+  if (accs_HasJit()) {
+    COMMENT(INDENT[3], "Hot interpreted regions compiled in background and loaded with dlopen");
+    fprintf( output,
+             "	typedef void (*ac_jit_entry_t)(%s*);\n"
+             "\n"
+             "	struct ac_jit_region {\n"
+             "		unsigned count;         //!< Entries while interpreted.\n"
+             "		unsigned gen;           //!< Bumped when the region code is modified.\n"
+             "		bool queued;\n"
+             "		bool failed;\n"
+             "		ac_jit_entry_t entry;   //!< Compiled region, if any.\n"
+             "		void* handle;           //!< Shared object of entry.\n"
+             "		ac_jit_region() : count(0), gen(0), queued(false), failed(false), entry(0), handle(0) {}\n"
+             "	};\n"
+             "\n"
+             "	struct ac_jit_job {\n"
+             "		unsigned region, gen, serial;\n"
+             "		std::string source;\n"
+             "	};\n"
+             "\n"
+             "	struct ac_jit_result {\n"
+             "		unsigned region, gen;\n"
+             "		ac_jit_entry_t entry;\n"
+             "		void* handle;\n"
+             "	};\n"
+             "\n"
+             "	std::map<unsigned, ac_jit_region> ac_jit_regions;\n"
+             "	unsigned ac_jit_threshold;    //!< Entries before compiling a region, 0 disables.\n"
+             "	unsigned ac_jit_outstanding;  //!< Jobs not harvested yet.\n"
+             "	unsigned ac_jit_compiled;     //!< Regions compiled so far.\n"
+             "	bool ac_jit_started;          //!< Whether the compiler thread runs.\n"
+             "	bool ac_jit_stopping;         //!< Asks the compiler thread to quit.\n"
+             "	std::string ac_jit_dir;       //!< Private directory for the region files.\n"
+             "	pthread_t ac_jit_thread;\n"
+             "	pthread_mutex_t ac_jit_mutex;   //!< Guards ac_jit_jobs, ac_jit_done and ac_jit_stopping.\n"
+             "	pthread_cond_t ac_jit_cond;\n"
+             "	std::deque<ac_jit_job> ac_jit_jobs;\n"
+             "	std::vector<ac_jit_result> ac_jit_done;\n"
+             "	std::vector<void*> ac_jit_retired;  //!< Shared objects no longer entered, closed by JitDispatch.\n"
+             "\n"
+             "	template <unsigned serial> void JitRegion();\n"
+             "	bool JitDispatch(unsigned region);\n"
+             "	void JitQueue(unsigned region, ac_jit_region& r);\n"
+             "	unsigned JitEmit(std::ostringstream& out, const unsigned* ac_fields);\n"
+             "	void JitHarvest();\n"
+             "	void JitRelease(bool all);\n"
+             "	bool JitStart();\n"
+             "	void JitStop();\n"
+             "	void JitLoop();\n"
+             "	void JitCompile(const ac_jit_job& job, ac_jit_result& result);\n"
+             "	static void* JitWorker(void* proc);\n"
+             "\n",
+             project_name);
+  }
+
   //Generic instruction behavior
   COMMENT(INDENT[3],"Generic instruction behavior");
 
@@ -1203,6 +1308,8 @@ void accs_CreateCompsimImpl()
 
     if (rblock == 0) {
       fprintf( output, "#include \"ac_prog_regions.H\"\n");
+      if (accs_HasInterp())
+        fprintf( output, "#include \"ac_isa_init.cpp\"\n");
     }
 
     fprintf( output, "\n");
@@ -1269,7 +1376,15 @@ void accs_CreateCompsimImpl()
       fprintf(output, "void %s::Region%d() {\n", project_name, i);
       fprintf(output,
               "\n"
-              "  while (1) {\n"
+              "  while (1) {\n");
+      if (accs_HasInterp())
+        fprintf(output,
+                "    //code was written: Execute() checks whether it is still valid\n"
+                "    if (ac_region_exit) {\n"
+                "      ac_region_exit = false;\n"
+                "      return;\n"
+                "    }\n");
+      fprintf(output,
               "    switch((int)ac_pc) {\n"
               "\n"
               );
@@ -1306,18 +1421,29 @@ void accs_CreateCompsimImpl()
       if ((PROCESSOR_OPTIMIZATIONS)&&(ACMulticoreFlag==1)) 
       	fprintf( output, "      old_pc = ac_pc;\n");
       if (i == EXIT_ADDRESS>>REGION_SIZE) fprintf( output, "      if (ac_pc == %d) return;\n", EXIT_ADDRESS);
+      if (accs_HasInterp())
+        fprintf( output,
+                 "      //not a compiled entry: interpret it and dispatch again\n"
+                 "      if ((ac_pc >= %d) && (ac_pc < %d)) {\n"
+                 "        InterpretStep();\n"
+                 "        break;\n"
+                 "      }\n"
+                 , (i << REGION_SIZE), ((i+1) << REGION_SIZE));
+      else
+        fprintf( output,
+                 "      if ((ac_pc >= %d) && (ac_pc < %d)) {\n"
+                 "        AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" points to an non-decoded memory location.\" << endl);\n"
+                 "        stop(EXIT_FAILURE);\n"
+                 "      }\n"
+                 , (i << REGION_SIZE), ((i+1) << REGION_SIZE));
       fprintf( output,
-               "      if ((ac_pc >= %d) && (ac_pc < %d)) {\n"
-               "        AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" points to an non-decoded memory location.\" << endl);\n"
-               "        stop(EXIT_FAILURE);\n"
-               "      }\n"
                "      return;\n"
                "    }\n"
                "  }\n"
                "}\n"
                "\n"
                "\n"
-               , (i << REGION_SIZE), ((i+1) << REGION_SIZE));
+               );
     }
 
 
@@ -1328,7 +1454,17 @@ void accs_CreateCompsimImpl()
       if (ACABIFlag) {fprintf(output, "  set_prog_args(argc, argv);\n\n");}
       fprintf(output,
              // "  extern int ac_stop_flag;\n"
-              "  while (!ac_stop_flag) {\n"
+              "  while (!ac_stop_flag) {\n");
+      if (accs_HasInterp())
+        fprintf(output,
+                "    //code outside the program image or modified at run time\n"
+                "    if (((ac_pc >> %d) > %d) || ac_region_stale[ac_pc >> %d]) {\n"
+                "      Interpret();\n"
+                "      continue;\n"
+                "    }\n"
+                "\n"
+                , REGION_SIZE, (prog_size_bytes-1) >> REGION_SIZE, REGION_SIZE);
+      fprintf(output,
               "    switch(ac_pc >> %d) {\n"
               "\n"
               , REGION_SIZE);
@@ -1360,6 +1496,9 @@ void accs_CreateCompsimImpl()
               "\n"
               );
 
+	if (accs_HasInterp())
+	  accs_EmitInterp(output);
+
 	fprintf(output, "#include <ac_sighandlers.H>\n\n");	
       	fprintf(output, "void %s::init(int ac, char **av){\n", project_name);
       	fprintf(output, "	this->ac = ac;\n");
@@ -1372,6 +1511,8 @@ void accs_CreateCompsimImpl()
 	fprintf(output, "		gdbstub->connect();\n");
 	fprintf(output, "   #endif /* USE_GDB */\n");
 	fprintf(output, "	ac_pc = ac_start_addr;\n");
+	if (accs_HasInterp())
+	  fprintf(output, "	InitInterp();\n");
 	fprintf(output, "	ac_behavior_begin();\n");
 	fprintf(output, "	cerr << \"ArchC: -------------------- Starting Simulation --------------------\" << endl;\n");
 	fprintf(output, "	InitStat();\n");
@@ -1399,6 +1540,8 @@ void accs_CreateCompsimImpl()
 	fprintf(output, "	ac_stop_flag = 1;\n");
 	fprintf(output, "	ac_exit_status = status;\n");
 	fprintf(output, "	ac_pc = ~0;\n");
+	if (accs_HasJit())
+	  fprintf(output, "	JitStop();\n");
 	fprintf(output, "	}\n\n");
 
 	fprintf(output, "void %s::InitStat(){\n", project_name);
@@ -1422,6 +1565,8 @@ void accs_CreateCompsimImpl()
 	fprintf(output, "	} else {\n");
 	fprintf(output, "		fprintf(stderr, \"    Simulation speed: (too fast to be precise)\\n\");\n");
 	fprintf(output, "	}\n");
+	if (accs_HasJit())
+	  fprintf(output, "	fprintf(stderr, \"    Regions compiled at run time: %%u\\n\", ac_jit_compiled);\n");
 	fprintf(output, "} \n\n");
 
 	// inserindo codigos do ac_syscall.cpp 
@@ -2450,13 +2595,35 @@ void fast_CreateStorageHeader()
           "  unsigned int start;\n"
           "  unsigned int size;\n"
           "\n"
+          "  //!Code write hook, see set_code_write()\n"
+          "  void (*code_write_fn)(void* arg, unsigned address, unsigned size);\n"
+          "  void *code_write_arg;\n"
+          "  unsigned char *code_pages;  //!< Pages flagged by mark_code().\n"
+          "\n"
           "public:\n"
           "\n"
+          "  static const unsigned code_page_bits = 12;\n"
+          "\n"
           "  access_t read() const {return read(0);}\n"
           "  void write(access_t datum) {return write(0,datum);}\n"
           "\n"
           "  unsigned int GetStart() {return start;}\n"
           "\n"
+          "  //!Makes writes to the pages flagged by mark_code() call fn(arg, address, size),\n"
+          "  //!so that the simulator drops the code it compiled or decoded from them.\n"
+          "  void set_code_write(void (*fn)(void*, unsigned, unsigned), void* arg) {\n"
+          "    code_write_fn = fn;\n"
+          "    code_write_arg = arg;\n"
+          "    if (!code_pages)\n"
+          "      code_pages = new unsigned char [(size >> code_page_bits) + 1]();\n"
+          "  }\n"
+          "\n"
+          "  //!Flags the page holding address as code.\n"
+          "  void mark_code(unsigned address) {\n"
+          "    if (code_pages && (address-start < size))\n"
+          "      code_pages[(address-start) >> code_page_bits] = 1;\n"
+          "  }\n"
+          "\n"
           "  elem_t *raw_data(unsigned address) const\n"
           "  {\n"
           "#ifdef AC_STATS\n"
@@ -2528,6 +2695,8 @@ void fast_CreateStorageHeader()
           "      exit(EXIT_FAILURE);\n"
           "    }\n"
           "#endif\n"
+          "    if (code_pages && code_pages[address >> code_page_bits])\n"
+          "      code_write_fn(code_write_arg, address, sizeof(access_t));\n"
           "  }\n"
           "\n"
           "  void write_byte(unsigned address, unsigned char datum) {\n"
@@ -2590,6 +2759,7 @@ void fast_CreateStorageHeader()
           "    start = _start;\n"
           "    size = (_size > c_size)? _size : c_size;\n"
           "    Data = new elem_t [size];\n"
+          "    code_pages = 0;\n"
           //"    memset(Data, 0, size);\n"
           "    if (contents) memcpy(Data, contents, c_size);\n"
           "    //cout << n << \" initialized.\" << endl;\n"
@@ -2602,6 +2772,7 @@ void fast_CreateStorageHeader()
           "  //!Destructor\n"
           "  ~ac_storage_tmpl() {\n"
           "    delete[] Data;\n"
+          "    delete[] code_pages;\n"
           "  }\n"
           "\n"
           "  access_t operator[] (unsigned address) {\n"
@@ -3715,9 +3886,17 @@ void accs_CreateISAInitImpl()
 
   print_comment( output, "ArchC ISA Init implementation file.");
 
-  fprintf(output,
-          "// This file is empty for compiled simulation\n"
-          );
+  if (accs_HasInterp()) {
+    fprintf(output,
+            "// Decoding structures used by the interpreter fallback.\n"
+            "// This file is included by the compiled simulator.\n\n"
+            );
+    accs_EmitDecStruct(output);
+  }
+  else
+    fprintf(output,
+            "// This file is empty for compiled simulation\n"
+            );
 
   fclose( output); 
 }
@@ -3861,6 +4040,13 @@ void accs_EmitMakefileExtra(FILE* output)
   	fprintf( output, "CFLAGS := $(CFLAGS) $(if $(filter 1,$(INLINE)),-O -finline-functions -fgcse) $(if $(filter 1,$(ISA_AND_SYSCALL_TOGETHER)), -DAC_INLINE) ");
   if (ACCompsimFlag) fprintf( output, "-DAC_COMPSIM");
   fprintf( output, "\n\n");
+
+  //Hot regions are compiled at run time with the same flags, against the
+  //model headers, and link back to the simulator
+  if (accs_HasJit()) {
+    fprintf( output, "CFLAGS := $(CFLAGS) -DAC_JIT_CXX='\"$(CC) $(CFLAGS) $(INC_DIR)\"' -DAC_JIT_DIR='\"$(CURDIR)\"'\n");
+    fprintf( output, "LIBS := $(LIBS) -rdynamic -ldl -lpthread\n\n");
+  }
 }
 
 
@@ -3873,6 +4059,718 @@ void accs_EmitParmsExtra(FILE* output)
 }
 
 
+//!Tells whether the simulator falls back to an interpreter for code that
+//!was not compiled. Optimization 2 resolves control flow at generation time
+//!and the ArchC library storage has no word reads, so both keep the error.
+int accs_HasInterp()
+{
+  extern int ACCompsimFlag;
+  return (ACCompsimFlag == 1) && (PROCESSOR_OPTIMIZATIONS != 2);
+}
+
+
+//!Hot interpreted regions are compiled at run time only in simulators
+//!generated with --jit
+int accs_HasJit()
+{
+  extern int ACJitFlag;
+  return accs_HasInterp() && ACJitFlag;
+}
+
+
+void accs_EmitDecStruct(FILE* output)
+{
+  ac_dec_format *pformat;
+  ac_dec_field *pfield;
+  ac_dec_instr *pinstr;
+  ac_dec_list *plist;
+  int i, nfields, nformats, nlists, ninstrs;
+
+  nfields = nformats = nlists = ninstrs = 0;
+  for (pformat = decoder->formats; pformat != NULL; pformat = pformat->next, nformats++)
+    for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+      nfields++;
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next, ninstrs++)
+    for (plist = pinstr->dec_list; plist != NULL; plist = plist->next)
+      nlists++;
+
+  //Fields: {name, size, first_bit, id, val, sign, next}
+  fprintf(output, "static ac_dec_field ac_interp_fields[%d] = {\n", nfields);
+  i = 0;
+  for (pformat = decoder->formats; pformat != NULL; pformat = pformat->next) {
+    for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next, i++) {
+      fprintf(output, "  {\"%s\", %d, %d, %d, %ld, %d, ", pfield->name, pfield->size,
+              pfield->first_bit, pfield->id, pfield->val, pfield->sign);
+      if (pfield->next) fprintf(output, "&ac_interp_fields[%d]},\n", i + 1);
+      else              fprintf(output, "NULL},\n");
+    }
+  }
+  fprintf(output, "};\n\n");
+
+  //Formats: {id, name, size, fields, next}
+  fprintf(output, "static ac_dec_format ac_interp_formats[%d] = {\n", nformats);
+  i = nfields = 0;
+  for (pformat = decoder->formats; pformat != NULL; pformat = pformat->next, i++) {
+    fprintf(output, "  {%u, \"%s\", %d, &ac_interp_fields[%d], ", pformat->id, pformat->name,
+            pformat->size, nfields);
+    if (pformat->next) fprintf(output, "&ac_interp_formats[%d]},\n", i + 1);
+    else               fprintf(output, "NULL},\n");
+    for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+      nfields++;
+  }
+  fprintf(output, "};\n\n");
+
+  //Decode lists: {name, id, value, next}
+  fprintf(output, "static ac_dec_list ac_interp_dec_list[%d] = {\n", nlists);
+  i = 0;
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next) {
+    for (plist = pinstr->dec_list; plist != NULL; plist = plist->next, i++) {
+      fprintf(output, "  {\"%s\", %d, %d, ", plist->name, plist->id, plist->value);
+      if (plist->next) fprintf(output, "&ac_interp_dec_list[%d]},\n", i + 1);
+      else             fprintf(output, "NULL},\n");
+    }
+  }
+  fprintf(output, "};\n\n");
+
+  //Instructions: {name, size, mnemonic, asm_str, format, id, cycles,
+  //               min_latency, max_latency, dec_list, cflow, next}
+  fprintf(output, "static ac_dec_instr ac_interp_instructions[%d] = {\n", ninstrs);
+  i = nlists = 0;
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next, i++) {
+    fprintf(output, "  {\"%s\", %d, \"%s\", \"%s\", \"%s\", %u, %u, %u, %u, &ac_interp_dec_list[%d], 0, ",
+            pinstr->name, pinstr->size, pinstr->mnemonic, pinstr->asm_str, pinstr->format,
+            pinstr->id, pinstr->cycles, pinstr->min_latency, pinstr->max_latency, nlists);
+    if (pinstr->next) fprintf(output, "&ac_interp_instructions[%d]},\n", i + 1);
+    else              fprintf(output, "NULL},\n");
+    for (plist = pinstr->dec_list; plist != NULL; plist = plist->next)
+      nlists++;
+  }
+  fprintf(output, "};\n\n");
+}
+
+
+//!Emits the interpreter that runs code outside the compiled regions: program
+//!parts loaded at run time (ac_rtld), generated code and regions invalidated
+//!by ac_invalidate_code(). Decoded instructions are kept in a direct-mapped
+//!cache indexed by address.
+void accs_EmitInterp(FILE* output)
+{
+  extern int ac_tgt_endian;
+  ac_dec_instr *pinstr;
+  int last_region = (prog_size_bytes-1) >> REGION_SIZE;
+  int min_size = decoder->instructions->size;
+  int max_size = decoder->instructions->size;
+  char *load_device = accs_FindLoadDevice()->name;
+
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next) {
+    if (pinstr->size < min_size) min_size = pinstr->size;
+    if (pinstr->size > max_size) max_size = pinstr->size;
+  }
+
+  fprintf(output, "void %s::InitInterp() {\n", project_name);
+  fprintf(output,
+          "  for (unsigned i = 0; i < AC_INTERP_CACHE_SIZE; i++)\n"
+          "    ac_interp_cache[i].fields[0] = 0;\n"
+          "  for (unsigned r = 0; r <= %d; r++)\n"
+          "    ac_region_stale[r] = false;\n"
+          "  ac_region_exit = false;\n"
+          "  ac_interp_decoder = ac_decoder_full::CreateDecoder(ac_interp_formats, ac_interp_instructions, this);\n"
+          "\n"
+          "  //Writes to the compiled image, or to code decoded later, invalidate it\n"
+          "  %s.set_code_write(ac_code_write, this);\n"
+          "  for (unsigned a = 0; a < %u; a += 1 << %s.code_page_bits)\n"
+          "    %s.mark_code(a);\n"
+          , last_region, load_device, prog_size_bytes, load_device, load_device);
+  if (accs_HasJit())
+    fprintf(output,
+            "\n"
+            "  //Hot regions are only compiled when asked to\n"
+            "  const char* jit = getenv(\"AC_JIT\");\n"
+            "  const char* threshold = getenv(\"AC_JIT_THRESHOLD\");\n"
+            "  ac_jit_threshold = 0;\n"
+            "  if (jit && *jit && strcmp(jit, \"0\"))\n"
+            "    ac_jit_threshold = threshold ? strtoul(threshold, NULL, 0) : %d;\n"
+            "  ac_jit_outstanding = 0;\n"
+            , JIT_THRESHOLD);
+  fprintf(output, "}\n\n");
+
+  //Reads instruction words from memory as the decoder asks for them
+  fprintf(output, "unsigned long long %s::GetBits(unsigned char* buffer, int* quant, int last, int quantity, int sign) {\n", project_name);
+  fprintf(output,
+          "  ac_Uword* words = (ac_Uword*) buffer;\n"
+          "  const int bits = sizeof(ac_Uword) * 8;\n"
+          "  int first = last - (quantity-1);\n"
+          "  int index_first = first / bits;\n"
+          "  int index_last = last / bits;\n"
+          "  unsigned long long value = 0;\n"
+          "\n"
+          "  for (; *quant <= index_last; (*quant)++)\n"
+          "    words[*quant] = %s.read(ac_interp_pc + *quant * sizeof(ac_Uword));\n"
+          "\n", accs_FindLoadDevice()->name);
+  if (ac_tgt_endian == 1)
+    fprintf(output,
+            "  for (int i = index_first; i <= index_last; i++) {\n"
+            "    value <<= bits;\n"
+            "    value |= words[i];\n"
+            "  }\n"
+            "  value >>= bits - (last %% bits + 1);\n");
+  else
+    fprintf(output,
+            "  for (int i = index_last; i >= index_first; i--) {\n"
+            "    value <<= bits;\n"
+            "    value |= words[i];\n"
+            "  }\n"
+            "  value >>= first %% bits;\n");
+  fprintf(output,
+          "\n"
+          "  value &= (~0ULL) >> (64 - quantity);\n"
+          "  if (sign && (value >> (quantity - 1)))\n"
+          "    value |= (~0ULL) << quantity;\n"
+          "  return value;\n"
+          "}\n\n");
+
+  //Decodes through the decode cache, NULL if the instruction is invalid
+  fprintf(output, "const unsigned* %s::InterpDecode(unsigned pc) {\n", project_name);
+  fprintf(output,
+          "  ac_interp_entry& entry = ac_interp_cache[(pc / %d) & (AC_INTERP_CACHE_SIZE - 1)];\n"
+          "\n"
+          "  if ((entry.pc != pc) || !entry.fields[0]) {\n"
+          "    ac_interp_pc = pc;\n"
+          "    if (!ac_interp_decoder->Decode((unsigned char*) ac_interp_buffer, 0, entry.fields)) {\n"
+          "      entry.fields[0] = 0;\n"
+          "      return NULL;\n"
+          "    }\n"
+          "    entry.pc = pc;\n"
+          "    %s.mark_code(pc);\n"
+          "    %s.mark_code(pc + %d);\n"
+          "  }\n"
+          "  return entry.fields;\n"
+          "}\n\n", min_size, load_device, load_device, max_size - 1);
+
+  //Runs one instruction at ac_pc
+  fprintf(output, "void %s::InterpretStep() {\n", project_name);
+  fprintf(output, "  switch((int)ac_pc) {\n\n");
+  if (ACABIFlag)
+    accs_EmitSyscalls(output, 0);
+  fprintf(output,
+          "    default: {\n"
+          "      const unsigned* ac_fields = InterpDecode((unsigned) ac_pc);\n"
+          "\n"
+          "      if (!ac_fields) {\n"
+          "        AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" points to an invalid instruction.\" << endl);\n"
+          "        stop(EXIT_FAILURE);\n"
+          "        return;\n"
+          "      }\n"
+          "\n"
+          "      switch (ac_fields[0]) {\n"
+          );
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next) {
+    fprintf(output, "      case %u:\n", pinstr->id);
+    fprintf(output, "        PRINT_TRACE;\n");
+    accs_EmitInterpBehavior(output, pinstr, 8);
+    fprintf(output, "        ac_instr_counter++;\n");
+    if (ACStatsFlag)
+      fprintf(output, "        ac_sim_stats.instr_table[%d].count++;\n", pinstr->id);
+    if (ACDelayFlag)
+      fprintf(output, "        delay::do_assignment();\n");
+    fprintf(output, "        break;\n");
+  }
+  fprintf(output,
+          "      }\n"
+          "      break;\n"
+          "    }\n"
+          "  }\n");
+  if ((PROCESSOR_OPTIMIZATIONS) && (ACMulticoreFlag == 1))
+    fprintf(output, "  old_pc = ac_pc;\n");
+  fprintf(output, "}\n\n");
+
+  //Interprets until the PC reaches a region that can run compiled,
+  //entering regions compiled at run time on the way
+  fprintf(output, "void %s::Interpret() {\n", project_name);
+  if (!accs_HasJit())
+    fprintf(output,
+            "  do {\n"
+            "    InterpretStep();\n"
+            "  } while (!ac_stop_flag &&\n"
+            "           (((ac_pc >> %d) > %d) || ac_region_stale[ac_pc >> %d]));\n"
+            "}\n\n", REGION_SIZE, last_region, REGION_SIZE);
+  else
+    fprintf(output,
+            "  unsigned region = ~0U;\n"
+            "  unsigned pc = 0;\n"
+            "\n"
+            "  do {\n"
+            "    //a region is entered when the PC moves into it or jumps back in it\n"
+            "    if (((ac_pc >> %d) != region) || (ac_pc < pc)) {\n"
+            "      region = ac_pc >> %d;\n"
+            "      if (JitDispatch(region)) {\n"
+            "        pc = ac_pc;\n"
+            "        continue;\n"
+            "      }\n"
+            "    }\n"
+            "    pc = ac_pc;\n"
+            "    InterpretStep();\n"
+            "  } while (!ac_stop_flag &&\n"
+            "           (((ac_pc >> %d) > %d) || ac_region_stale[ac_pc >> %d]));\n"
+            "}\n\n", REGION_SIZE, REGION_SIZE, REGION_SIZE, last_region, REGION_SIZE);
+
+  //Called when code is written at run time, by the load device on writes
+  //to code pages or by the model (e.g. a loader writing through raw_data):
+  //the regions covering it are interpreted from the next region dispatch
+  //on, until they get hot again
+  fprintf(output, "void %s::ac_invalidate_code(unsigned address, unsigned size) {\n", project_name);
+  fprintf(output,
+          "  if (!size)\n"
+          "    return;\n"
+          "\n"
+          "  //The last byte written, clamped at the top of the address space\n"
+          "  unsigned last = (size - 1 > ~0U - address) ? ~0U : address + (size - 1);\n"
+          "\n"
+          "  //Decodes overlapping the write start up to %d bytes before it\n"
+          "  unsigned first = (address < %d) ? 0 : address - %d;\n"
+          "  first -= first %% %d;\n"
+          "  if ((last - first) / %d >= AC_INTERP_CACHE_SIZE) {\n"
+          "    for (unsigned i = 0; i < AC_INTERP_CACHE_SIZE; i++)\n"
+          "      if (ac_interp_cache[i].pc - first <= last - first)\n"
+          "        ac_interp_cache[i].fields[0] = 0;\n"
+          "  }\n"
+          "  else\n"
+          "    for (unsigned pc = first; pc - first <= last - first; pc += %d) {\n"
+          "      ac_interp_entry& entry = ac_interp_cache[(pc / %d) & (AC_INTERP_CACHE_SIZE - 1)];\n"
+          "      if (entry.pc - first <= last - first)\n"
+          "        entry.fields[0] = 0;\n"
+          "    }\n"
+          "\n"
+          "  //Only the compiled image has compiled regions. The running one may be\n"
+          "  //among them: it returns at its next dispatch\n"
+          "  if (address < %u) {\n"
+          "    for (unsigned r = address >> %d; (r <= %d) && (r <= (last >> %d)); r++)\n"
+          "      ac_region_stale[r] = true;\n"
+          "    ac_region_exit = true;\n"
+          "  }\n"
+          , max_size - 1, max_size - 1, max_size - 1, min_size, min_size, min_size, min_size,
+          prog_size_bytes, REGION_SIZE, last_region, REGION_SIZE);
+  if (accs_HasJit())
+    fprintf(output,
+            "\n"
+            "  //Regions compiled at run time are dropped, and so are their pending jobs\n"
+            "  std::map<unsigned, ac_jit_region>::iterator it = ac_jit_regions.lower_bound(address >> %d);\n"
+            "  for (; (it != ac_jit_regions.end()) && (it->first <= (last >> %d)); it++) {\n"
+            "    it->second.count = 0;\n"
+            "    it->second.gen++;\n"
+            "    it->second.failed = false;\n"
+            "    it->second.entry = 0;\n"
+            "    //the region may be running: its shared object is closed later\n"
+            "    if (it->second.handle)\n"
+            "      ac_jit_retired.push_back(it->second.handle);\n"
+            "    it->second.handle = 0;\n"
+            "    ac_region_exit = true;\n"
+            "  }\n"
+            , REGION_SIZE, REGION_SIZE);
+  fprintf(output, "}\n\n");
+
+  fprintf(output, "void %s::ac_code_write(void* proc, unsigned address, unsigned size) {\n", project_name);
+  fprintf(output,
+          "  ((%s*) proc)->ac_invalidate_code(address, size);\n"
+          "}\n\n", project_name);
+
+  if (accs_HasJit())
+    accs_EmitJit(output);
+}
+
+
+//!Same as accs_EmitInstrBehavior, but taking the fields from the decode cache
+void accs_EmitInterpBehavior(FILE* output, ac_dec_instr *pinstr, int indent)
+{
+  extern ac_dec_field *common_instr_field_list;
+  ac_dec_format *pformat = FindFormat(decoder->formats, pinstr->format);
+  ac_dec_field *pfield, *pcommon;
+
+  fprintf(output, "%*sac_behavior_instruction(%d", indent, " ", pinstr->size * 8); /* ac_instr_size: in bits */
+  for (pcommon = common_instr_field_list; pcommon != NULL; pcommon = pcommon->next) {
+    for (pfield = pformat->fields; (pfield != NULL) && strcmp(pfield->name, pcommon->name); pfield = pfield->next);
+    if (pfield) fprintf(output, ", ac_fields[%d]", pfield->id);
+    else        fprintf(output, ", 0");
+  }
+  fprintf(output, ");\n");
+
+  if (ACAnnulSigFlag)
+    fprintf(output, "%*sif (!ac_annul_sig) {\n", indent, " ");
+
+  fprintf(output, "%*sac_behavior_%s(%d", indent, " ", pinstr->format, pinstr->size * 8);
+  for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+    fprintf(output, ", ac_fields[%d]", pfield->id);
+  fprintf(output, ");\n");
+
+  fprintf(output, "%*sac_behavior_%s(%d", indent, " ", pinstr->name, pinstr->size * 8);
+  for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+    fprintf(output, ", ac_fields[%d]", pfield->id);
+  fprintf(output, ");\n");
+
+  if (ACAnnulSigFlag) {
+    fprintf(output, "%*s} else\n", indent, " ");
+    fprintf(output, "%*sac_annul_sig = 0;\n", indent, " ");
+  }
+}
+
+
+//!Emits the run-time compilation of hot interpreted regions. Each region
+//!entry is counted; when a region gets hot its code is emitted in the same
+//!shape as the Region functions, from the decode cache, and a background
+//!thread compiles it into a shared object and loads it with dlopen.
+void accs_EmitJit(FILE* output)
+{
+  ac_dec_instr *pinstr;
+  int min_size = decoder->instructions->size;
+  int abi_region = -1;
+
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next)
+    if (pinstr->size < min_size) min_size = pinstr->size;
+
+  //Regions with the special syscall addresses are never compiled at run time
+  if (ACABIFlag) {
+#define AC_SYSC(NAME,LOCATION) if (abi_region < ((LOCATION) >> REGION_SIZE)) abi_region = (LOCATION) >> REGION_SIZE;
+#include "ac_syscall.def"
+#undef AC_SYSC
+  }
+
+  fprintf(output,
+          "#include <dlfcn.h>\n"
+          "#include <unistd.h>\n"
+          "#include <fstream>\n"
+          "\n"
+          "//Compiler used for hot regions and where the model headers were\n"
+          "//generated, both set by the Makefile\n"
+          "#ifndef AC_JIT_CXX\n"
+          "#define AC_JIT_CXX \"g++ -O2 `pkg-config --cflags systemc archc`\"\n"
+          "#endif\n"
+          "#ifndef AC_JIT_DIR\n"
+          "#define AC_JIT_DIR \".\"\n"
+          "#endif\n"
+          "\n");
+
+  //Runs the compiled version of a region, or counts its entry
+  fprintf(output, "bool %s::JitDispatch(unsigned region) {\n", project_name);
+  fprintf(output,
+          "  //No compiled region is running here\n"
+          "  if (!ac_jit_retired.empty())\n"
+          "    JitRelease(false);\n"
+          "  if (!ac_jit_threshold)\n"
+          "    return false;\n"
+          "  if (ac_jit_outstanding)\n"
+          "    JitHarvest();\n"
+          "\n"
+          "  ac_jit_region& r = ac_jit_regions[region];\n"
+          "  if (r.entry) {\n"
+          "    r.entry(this);\n");
+  if ((PROCESSOR_OPTIMIZATIONS) && (ACMulticoreFlag == 1))
+    fprintf(output, "    old_pc = ac_pc;\n");
+  fprintf(output,
+          "    return true;\n"
+          "  }\n"
+          "  if (!r.queued && !r.failed && (++r.count >= ac_jit_threshold) && ((int) region > %d))\n"
+          "    JitQueue(region, r);\n"
+          "  return false;\n"
+          "}\n\n", abi_region);
+
+  //Emits the region source and hands it to the compiler thread
+  fprintf(output, "void %s::JitQueue(unsigned region, ac_jit_region& r) {\n", project_name);
+  fprintf(output,
+          "  static unsigned serial = 0;\n"
+          "  unsigned end = (region + 1) << %d;\n"
+          "  ac_jit_job job;\n"
+          "  std::ostringstream out;\n"
+          "\n"
+          "  if (!end || (end > %u))\n"
+          "    end = %u;\n"
+          "  job.region = region;\n"
+          "  job.gen = r.gen;\n"
+          "  job.serial = ++serial;\n"
+          "\n"
+          , REGION_SIZE, accs_FindLoadDevice()->size, accs_FindLoadDevice()->size);
+  fprintf(output,
+          "  out << \"#include \\\"%s.H\\\"\\n\"\n"
+          "         \"#include \\\"%s_isa.H\\\"\\n\"\n"
+          "         \"\\n\"\n"
+          "         \"#ifdef AC_DEBUG\\n\"\n"
+          "         \"#include <iostream>\\n\"\n"
+          "         \"extern std::ofstream trace_file;\\n\"\n"
+          "         \"#define PRINT_TRACE trace_file << std::hex << ((int)ac_pc) << \\\"\\\\n\\\"\\n\"\n"
+          "         \"#else\\n\"\n"
+          "         \"#define PRINT_TRACE /* nothing */\\n\"\n"
+          "         \"#endif\\n\"\n"
+          "         \"\\n\"\n"
+          "      << \"template <> void %s::JitRegion<\" << job.serial << \">() {\\n\"\n"
+          "         \"\\n\"\n"
+          "         \"  while (1) {\\n\"\n"
+          "         \"    if (ac_region_exit) {\\n\"\n"
+          "         \"      ac_region_exit = false;\\n\"\n"
+          "         \"      return;\\n\"\n"
+          "         \"    }\\n\"\n"
+          "         \"    switch((int)ac_pc) {\\n\"\n"
+          "         \"\\n\";\n"
+          "\n"
+          , project_name, project_name, project_name);
+  fprintf(output,
+          "  for (unsigned pc = region << %d; pc < end; ) {\n"
+          "    const unsigned* fields = InterpDecode(pc);\n"
+          "    if (!fields) {\n"
+          "      pc += %d;\n"
+          "      continue;\n"
+          "    }\n"
+          "    out << \"    case 0x\" << std::hex << pc << std::dec << \":\\n\";\n"
+          "    pc += JitEmit(out, fields);\n"
+          "  }\n"
+          "\n"
+          , REGION_SIZE, min_size);
+  fprintf(output,
+          "  out << \"    default:\\n\"\n"
+          "         \"      return;\\n\"\n"
+          "         \"    }\\n\"\n"
+          "         \"  }\\n\"\n"
+          "         \"}\\n\"\n"
+          "         \"\\n\"\n"
+          "         \"extern \\\"C\\\" void ac_jit_entry(%s* proc) {\\n\"\n"
+          "         \"  proc->JitRegion<\" << job.serial << \">();\\n\"\n"
+          "         \"}\\n\";\n"
+          "  job.source = out.str();\n"
+          "\n"
+          "  if (!ac_jit_started && !JitStart()) {\n"
+          "    r.failed = true;\n"
+          "    return;\n"
+          "  }\n"
+          "\n"
+          "  r.queued = true;\n"
+          "  ac_jit_outstanding++;\n"
+          "  pthread_mutex_lock(&ac_jit_mutex);\n"
+          "  ac_jit_jobs.push_back(job);\n"
+          "  pthread_cond_signal(&ac_jit_cond);\n"
+          "  pthread_mutex_unlock(&ac_jit_mutex);\n"
+          "}\n\n", project_name);
+
+  //Emits one instruction of a region, returns its size
+  fprintf(output, "unsigned %s::JitEmit(std::ostringstream& out, const unsigned* ac_fields) {\n", project_name);
+  fprintf(output, "  switch (ac_fields[0]) {\n");
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next) {
+    fprintf(output, "  case %u:\n", pinstr->id);
+    fprintf(output, "    out << \"      PRINT_TRACE;\\n\";\n");
+    accs_EmitJitBehavior(output, pinstr, 4);
+    fprintf(output, "    out << \"      ac_instr_counter++;\\n\";\n");
+    if (ACStatsFlag)
+      fprintf(output, "    out << \"      ac_sim_stats.instr_table[%d].count++;\\n\";\n", pinstr->id);
+    if (ACDelayFlag)
+      fprintf(output, "    out << \"      delay::do_assignment();\\n\";\n");
+    fprintf(output, "    out << \"      break;\\n\\n\";\n");
+    fprintf(output, "    return %d;\n", pinstr->size);
+  }
+  fprintf(output,
+          "  }\n"
+          "  return %d;\n"
+          "}\n\n", min_size);
+
+  //Takes the regions already compiled by the thread
+  fprintf(output, "void %s::JitHarvest() {\n", project_name);
+  fprintf(output,
+          "  std::vector<ac_jit_result> done;\n"
+          "\n"
+          "  if (pthread_mutex_trylock(&ac_jit_mutex))\n"
+          "    return;\n"
+          "  done.swap(ac_jit_done);\n"
+          "  pthread_mutex_unlock(&ac_jit_mutex);\n"
+          "\n"
+          "  for (std::vector<ac_jit_result>::iterator it = done.begin(); it != done.end(); it++) {\n"
+          "    ac_jit_region& r = ac_jit_regions[it->region];\n"
+          "\n"
+          "    ac_jit_outstanding--;\n"
+          "    r.queued = false;\n"
+          "    if (it->gen != r.gen) {  //modified while compiling\n"
+          "      if (it->handle)\n"
+          "        ac_jit_retired.push_back(it->handle);\n"
+          "      continue;\n"
+          "    }\n"
+          "    if (!it->entry) {\n"
+          "      AC_ERROR(\"could not compile the region at 0x\" << hex << (it->region << %d) << \", it stays interpreted.\" << endl);\n"
+          "      r.failed = true;\n"
+          "    }\n"
+          "    else\n"
+          "      ac_jit_compiled++;\n"
+          "    if (r.handle)\n"
+          "      ac_jit_retired.push_back(r.handle);\n"
+          "    r.entry = it->entry;\n"
+          "    r.handle = it->handle;\n"
+          "  }\n"
+          "}\n\n", REGION_SIZE);
+
+  //Closes the shared objects of dropped regions, or of all regions when
+  //the simulator is destroyed. Never called while a compiled region runs.
+  fprintf(output, "void %s::JitRelease(bool all) {\n", project_name);
+  fprintf(output,
+          "  if (all)\n"
+          "    for (std::map<unsigned, ac_jit_region>::iterator it = ac_jit_regions.begin(); it != ac_jit_regions.end(); it++)\n"
+          "      if (it->second.handle) {\n"
+          "        ac_jit_retired.push_back(it->second.handle);\n"
+          "        it->second.entry = 0;\n"
+          "        it->second.handle = 0;\n"
+          "      }\n"
+          "\n"
+          "  for (std::vector<void*>::iterator it = ac_jit_retired.begin(); it != ac_jit_retired.end(); it++)\n"
+          "    dlclose(*it);\n"
+          "  ac_jit_retired.clear();\n"
+          "}\n\n");
+
+  //Starts the compiler thread with the first job, in a private directory
+  //for the region sources and shared objects
+  fprintf(output, "bool %s::JitStart() {\n", project_name);
+  fprintf(output,
+          "  const char* tmpdir = getenv(\"TMPDIR\");\n"
+          "  std::string dir = std::string(tmpdir ? tmpdir : \"/tmp\") + \"/ac_jit.XXXXXX\";\n"
+          "  std::vector<char> name(dir.begin(), dir.end());\n"
+          "\n"
+          "  name.push_back(0);\n"
+          "  if (!mkdtemp(&name[0])) {\n"
+          "    AC_ERROR(\"could not create \" << dir << \", hot regions stay interpreted.\" << endl);\n"
+          "    ac_jit_threshold = 0;\n"
+          "    return false;\n"
+          "  }\n"
+          "  ac_jit_dir = &name[0];\n"
+          "\n"
+          "  ac_jit_stopping = false;\n"
+          "  pthread_mutex_init(&ac_jit_mutex, NULL);\n"
+          "  pthread_cond_init(&ac_jit_cond, NULL);\n"
+          "  if (pthread_create(&ac_jit_thread, NULL, JitWorker, this)) {\n"
+          "    AC_ERROR(\"could not start the region compiler, hot regions stay interpreted.\" << endl);\n"
+          "    pthread_cond_destroy(&ac_jit_cond);\n"
+          "    pthread_mutex_destroy(&ac_jit_mutex);\n"
+          "    rmdir(ac_jit_dir.c_str());\n"
+          "    ac_jit_threshold = 0;\n"
+          "    return false;\n"
+          "  }\n"
+          "  ac_jit_started = true;\n"
+          "  return true;\n"
+          "}\n\n");
+
+  //Called when the simulation stops: pending jobs are dropped and a
+  //compile in progress is waited for. Regions are not compiled afterwards.
+  fprintf(output, "void %s::JitStop() {\n", project_name);
+  fprintf(output,
+          "  if (!ac_jit_started)\n"
+          "    return;\n"
+          "\n"
+          "  pthread_mutex_lock(&ac_jit_mutex);\n"
+          "  ac_jit_stopping = true;\n"
+          "  pthread_cond_signal(&ac_jit_cond);\n"
+          "  pthread_mutex_unlock(&ac_jit_mutex);\n"
+          "  pthread_join(ac_jit_thread, NULL);\n"
+          "\n"
+          "  ac_jit_started = false;\n"
+          "  ac_jit_threshold = 0;\n"
+          "  ac_jit_outstanding = 0;\n"
+          "  ac_jit_jobs.clear();\n"
+          "  ac_jit_done.clear();\n"
+          "  pthread_cond_destroy(&ac_jit_cond);\n"
+          "  pthread_mutex_destroy(&ac_jit_mutex);\n"
+          "  rmdir(ac_jit_dir.c_str());\n"
+          "}\n\n");
+
+  //Compiler thread
+  fprintf(output, "void* %s::JitWorker(void* proc) {\n", project_name);
+  fprintf(output,
+          "  ((%s*) proc)->JitLoop();\n"
+          "  return NULL;\n"
+          "}\n\n", project_name);
+
+  fprintf(output, "void %s::JitLoop() {\n", project_name);
+  fprintf(output,
+          "  pthread_mutex_lock(&ac_jit_mutex);\n"
+          "  while (1) {\n"
+          "    while (ac_jit_jobs.empty() && !ac_jit_stopping)\n"
+          "      pthread_cond_wait(&ac_jit_cond, &ac_jit_mutex);\n"
+          "    if (ac_jit_stopping)\n"
+          "      break;\n"
+          "    ac_jit_job job = ac_jit_jobs.front();\n"
+          "    ac_jit_jobs.pop_front();\n"
+          "    pthread_mutex_unlock(&ac_jit_mutex);\n"
+          "\n"
+          "    ac_jit_result result;\n"
+          "    result.region = job.region;\n"
+          "    result.gen = job.gen;\n"
+          "    JitCompile(job, result);\n"
+          "\n"
+          "    pthread_mutex_lock(&ac_jit_mutex);\n"
+          "    ac_jit_done.push_back(result);\n"
+          "  }\n"
+          "  pthread_mutex_unlock(&ac_jit_mutex);\n"
+          "}\n\n");
+
+  //The executable is linked with -rdynamic, so the shared object binds to
+  //the behaviors and storage of the simulator
+  fprintf(output, "void %s::JitCompile(const ac_jit_job& job, ac_jit_result& result) {\n", project_name);
+  fprintf(output,
+          "  std::ostringstream base;\n"
+          "\n"
+          "  result.entry = 0;\n"
+          "  result.handle = 0;\n"
+          "  base << ac_jit_dir << \"/region.\" << job.serial;\n"
+          "  std::string src = base.str() + \".cpp\";\n"
+          "  std::string lib = base.str() + \".so\";\n"
+          "  std::string cmd = std::string(AC_JIT_CXX) + \" -shared -fPIC -I\" AC_JIT_DIR \" -o \" + lib + \" \" + src + \" >/dev/null 2>&1\";\n"
+          "\n"
+          "  std::ofstream file(src.c_str());\n"
+          "  file << job.source;\n"
+          "  file.close();\n"
+          "\n"
+          "  if (file && (system(cmd.c_str()) == 0)) {\n"
+          "    result.handle = dlopen(lib.c_str(), RTLD_NOW | RTLD_LOCAL);\n"
+          "    if (result.handle) {\n"
+          "      result.entry = (ac_jit_entry_t) dlsym(result.handle, \"ac_jit_entry\");\n"
+          "      if (!result.entry) {\n"
+          "        dlclose(result.handle);\n"
+          "        result.handle = 0;\n"
+          "      }\n"
+          "    }\n"
+          "  }\n"
+          "  unlink(src.c_str());\n"
+          "  unlink(lib.c_str());\n"
+          "}\n\n");
+}
+
+
+//!Same as accs_EmitInterpBehavior, but emitting the statements that write the
+//!behavior calls, with the field values, into a region source
+void accs_EmitJitBehavior(FILE* output, ac_dec_instr *pinstr, int indent)
+{
+  extern ac_dec_field *common_instr_field_list;
+  ac_dec_format *pformat = FindFormat(decoder->formats, pinstr->format);
+  ac_dec_field *pfield, *pcommon;
+
+  fprintf(output, "%*sout << \"      ac_behavior_instruction(%d\"", indent, " ", pinstr->size * 8);
+  for (pcommon = common_instr_field_list; pcommon != NULL; pcommon = pcommon->next) {
+    for (pfield = pformat->fields; (pfield != NULL) && strcmp(pfield->name, pcommon->name); pfield = pfield->next);
+    if (pfield) fprintf(output, " << \", \" << %sac_fields[%d]", pfield->sign ? "(int) " : "", pfield->id);
+    else        fprintf(output, " << \", 0\"");
+  }
+  fprintf(output, " << \");\\n\";\n");
+
+  if (ACAnnulSigFlag)
+    fprintf(output, "%*sout << \"      if (!ac_annul_sig) {\\n\";\n", indent, " ");
+
+  fprintf(output, "%*sout << \"      ac_behavior_%s(%d\"", indent, " ", pinstr->format, pinstr->size * 8);
+  for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+    fprintf(output, " << \", \" << %sac_fields[%d]", pfield->sign ? "(int) " : "", pfield->id);
+  fprintf(output, " << \");\\n\";\n");
+
+  fprintf(output, "%*sout << \"      ac_behavior_%s(%d\"", indent, " ", pinstr->name, pinstr->size * 8);
+  for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+    fprintf(output, " << \", \" << %sac_fields[%d]", pfield->sign ? "(int) " : "", pfield->id);
+  fprintf(output, " << \");\\n\";\n");
+
+  if (ACAnnulSigFlag) {
+    fprintf(output, "%*sout << \"      } else\\n\";\n", indent, " ");
+    fprintf(output, "%*sout << \"      ac_annul_sig = 0;\\n\";\n", indent, " ");
+  }
+}
+
+
 ac_sto_list *accs_FindLoadDevice()
 {
   //Already set?
@@ -116,6 +116,9 @@ void fast_CreateFileResourcesImpl();
 
 
 
+int  accs_HasInterp();
+int  accs_HasJit();
+
 void accs_CreateEmptyFiles(int quant, ...);
 char *accs_Fields2Str(instr_decode_t* decoded_instr);
 char *accs_SubstFields(char* expression, int j);
@@ -131,6 +134,10 @@ void accs_EmitInstrExtraTop(FILE* output, int j, ac_dec_instr *pinstr, int inden
 void accs_EmitInstrExtraBottom(FILE* output, int j, ac_dec_instr *pinstr, int indent);
 void accs_EmitMakefileExtra(FILE* output);
 void accs_EmitParmsExtra(FILE* output);
+void accs_EmitInterp(FILE* output);
+void accs_EmitInterpBehavior(FILE* output, ac_dec_instr *pinstr, int indent);
+void accs_EmitJit(FILE* output);
+void accs_EmitJitBehavior(FILE* output, ac_dec_instr *pinstr, int indent);
 
 
 #endif /*_ACCS_H_*/
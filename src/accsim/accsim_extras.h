@@ -40,6 +40,14 @@ int REGION_BLOCK_SIZE=300;
 #define EXIT_ADDRESS 0x64
 #endif
 
+#ifndef INTERP_CACHE_BITS
+#define INTERP_CACHE_BITS 12
+#endif
+
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 1000
+#endif
+
 ////////////////////////////////
 // COUNT_SYSCALLS
 ////////////////////////////////
@@ -73,6 +73,7 @@ int  ACEncoderFlag=0;                           //!<Indicates whether encoder to
 int  ACGDBIntegrationFlag=0;                    //!<Indicates whether gdb support will be included in the simulator
 int  ACMulticoreFlag=0;				//!<Indicates whether the simulator will multicore suport or not
 int  ACAnnulSigFlag=0;							//!<Indicates whether one instruction may be executed or not
+int  ACJitFlag=0;                               //!<Indicates whether hot interpreted code may be compiled at run time
 
 char *ACVersion = "2.1.0";                      //!<Stores ArchC version number.
 char ACOptions[500];                            //!<Stores ArchC recognized command line options
@@ -127,6 +128,7 @@ struct option_map option_map[] = {
   {"--block-size"    , "-bs"         ,"Set the maximum number of regions in a file.", "r"},
   {"--multicore"     , "-mc"	     ,"Beta version for static Compiled Simulation multicore.", "r"},
   {"--annul-instr"   , "-ai"         ,"Necessary in models wich the instructions may be executed or not", "r"},
+  {"--jit"           , "-jit"        ,"Compile hot code outside the program image at run time (when run with AC_JIT=1).", "o"},
 /*   {"--pentium4"      , "-p4"         ,"Use option for gcc: -march=pentium4.", "r"}, */
 /*   {"--omit-frame-p"  , "-omitfp"     ,"Use option for gcc: -fomit-frame-pointer.", "r"}, */
   { }
@@ -451,6 +453,10 @@ int main( argc, argv )
 	    	ACAnnulSigFlag = 1;
 	    	ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
 	    break;
+            case OPJit:
+              ACJitFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
 
             default:
               break;
@@ -114,6 +114,7 @@ enum _ac_cmd_options {
   OPRegionBlockSize,
   OPMulticore, 
   OPAnnulSig,
+  OPJit,
 /*   OPP4, */
 /*   OPOmitFP, */
   ACNumberOfOptions
@@ -1,13 +1,53 @@
 #include "ac_cache_trace.H"
 
-ac_cache_trace::ac_cache_trace(std::ostream &o) : out(o) 
+#include <string.h>
+#include <iostream>
+
+ac_cache_trace::ac_cache_trace(std::ostream &o, bool b) : out(o), binary(b),
+	last_address(0), last_length(0), writer(NULL)
+{
+	if (!binary) {
+		out << std::hex;
+		return;
+	}
+
+	out.write(AC_CACHE_TRACE_MAGIC, 8);
+	writer = new ac_chunk_writer(out, max_record, "cache trace");
+}
+
+ac_cache_trace::~ac_cache_trace()
 {
-	out << std::hex;
+	delete writer;
+	out.flush();
+}
+
+static inline unsigned char *put_number(unsigned char *p, unsigned v)
+{
+	while (v >= 0x80) {
+		*p++ = (unsigned char) (v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (unsigned char) v;
+	return p;
 }
-ac_cache_trace::~ac_cache_trace() { out.flush(); }
 
 void ac_cache_trace::add(trace_operation o, unsigned a, unsigned l)
 {
+	if (binary) {
+		int delta = (int) (a - last_address);
+		unsigned char *p = writer->get();
+
+		*p++ = (o == trace_write) | ((l == last_length) << 1);
+		p = put_number(p, ((unsigned) delta << 1) ^ (unsigned) (delta >> 31));
+		if (l != last_length)
+			p = put_number(p, l);
+
+		last_address = a;
+		last_length = l;
+		writer->put(p);
+		return;
+	}
+
 	if (o == trace_read) {
 		out << "r ";
 	}
@@ -17,3 +57,57 @@ void ac_cache_trace::add(trace_operation o, unsigned a, unsigned l)
 	out << a << " " << l << '\n';
 }
 
+ac_cache_trace_reader::ac_cache_trace_reader(std::istream &i) : in(i),
+	binary(false), last_address(0), last_length(0)
+{
+	char magic[8];
+
+	if (in.peek() != AC_CACHE_TRACE_MAGIC[0])
+		return;
+
+	in.read(magic, 8);
+	binary = in && !memcmp(magic, AC_CACHE_TRACE_MAGIC, 8);
+	if (!binary)
+		in.setstate(std::ios::failbit);
+}
+
+bool ac_cache_trace_reader::get_number(unsigned &v)
+{
+	int c;
+	unsigned shift = 0;
+
+	v = 0;
+	do {
+		if ((c = in.get()) == EOF || shift > 28)
+			return false;
+		v |= (unsigned) (c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return true;
+}
+
+bool ac_cache_trace_reader::next(trace_operation &o, unsigned &a, unsigned &l)
+{
+	if (binary) {
+		int tag = in.get();
+		unsigned delta;
+
+		if (tag == EOF || !get_number(delta))
+			return false;
+		if (!(tag & 2) && !get_number(last_length))
+			return false;
+
+		last_address += (delta >> 1) ^ -(delta & 1);
+		o = (tag & 1) ? trace_write : trace_read;
+		a = last_address;
+		l = last_length;
+		return true;
+	}
+
+	char c;
+	if (!(in >> c >> std::hex >> a >> l))
+		return false;
+	o = (c == 'w') ? trace_write : trace_read;
+	return true;
+}
+
@@ -0,0 +1,79 @@
+/**
+ * @file      actraceconvert.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Converts ArchC cache traces between the text and the binary
+ *            formats. The input format is detected; the output is the
+ *            other one.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+
+#include "ac_cache_trace.H"
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <input trace> <output trace>\n"
+		          << "Converts a binary cache trace to text, or a text one to binary.\n";
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream in(argv[1], std::ios::in | std::ios::binary);
+	if (!in) {
+		std::cerr << "Error opening file: " << argv[1] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	ac_cache_trace_reader reader(in);
+	if (!in) {
+		std::cerr << "Error: " << argv[1] << " is not a cache trace\n";
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream out(argv[2], std::ios::out | std::ios::binary);
+	if (!out) {
+		std::cerr << "Error opening file: " << argv[2] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	unsigned long long records = 0;
+	{
+		ac_cache_trace writer(out, !reader.is_binary());
+		trace_operation o;
+		unsigned a, l;
+
+		while (reader.next(o, a, l)) {
+			writer.add(o, a, l);
+			records++;
+		}
+	}
+
+	if (!out) {
+		std::cerr << "Error writing file: " << argv[2] << "\n";
+		return EXIT_FAILURE;
+	}
+
+	std::cerr << records << " records converted to "
+	          << (reader.is_binary() ? "text" : "binary") << "\n";
+	return EXIT_SUCCESS;
+}
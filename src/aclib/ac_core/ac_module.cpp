@@ -58,13 +58,37 @@ unsigned ac_module::running_mods = 0;
 /// List of all modules.
 std::list<ac_module*> ac_module::mods_list;
 
+/// Whether behaviors run on host threads.
+bool ac_module::parallel = false;
+
+/// Lock guarding the host thread states and the shared resources.
+pthread_mutex_t ac_module::host_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/// Signaled when the SystemC kernel blocks waiting for a host thread.
+pthread_cond_t ac_module::host_free = PTHREAD_COND_INITIALIZER;
+
+/// Whether the SystemC kernel is running.
+bool ac_module::kernel_running = true;
+
+/// Whether the last running module stopped from a host thread.
+bool ac_module::host_stop = false;
+
+/// Module whose behavior runs on the current host thread.
+static __thread ac_module* current_host_module = NULL;
+
 /// Standard constructor.
 ac_module::ac_module() : sc_module(sc_gen_unique_name("ac_module")),
 			 mod_id(next_mod_id++),
-			 ac_exit_status(0){
+			 ac_exit_status(0),
+			 cosim(NULL){
   ac_qk.set_global_quantum( sc_time(100, SC_NS) );
   ac_qk.reset();
   module_period_ns=5;  //200 MHz = 5ns
+  host_state = HOST_RUN;
+  host_event = NULL;
+  host_fn = NULL;
+  host_arg = NULL;
+  pthread_cond_init(&host_cond, NULL);
   this_mod = mods_list.insert(mods_list.end(), this);
   return;
 }
@@ -72,10 +96,16 @@ ac_module::ac_module() : sc_module(sc_gen_unique_name("ac_module")),
 /// Named constructor.
 ac_module::ac_module(sc_module_name nm) : sc_module(nm),
 			 mod_id(next_mod_id++),
-			 ac_exit_status(0){
+			 ac_exit_status(0),
+			 cosim(NULL){
   ac_qk.set_global_quantum( sc_time(100, SC_NS) );
   ac_qk.reset();
   module_period_ns=5;  //200 MHz = 5ns
+  host_state = HOST_RUN;
+  host_event = NULL;
+  host_fn = NULL;
+  host_arg = NULL;
+  pthread_cond_init(&host_cond, NULL);
   this_mod = mods_list.insert(mods_list.end(), this);
   return;
 }
@@ -84,6 +114,7 @@ ac_module::ac_module(sc_module_name nm) : sc_module(nm),
 ac_module::~ac_module()
 {
   mods_list.erase(this_mod);
+  pthread_cond_destroy(&host_cond);
   return;
 }
 
@@ -104,14 +135,37 @@ void ac_module::PrintAllStats()
   return;
 }
 
+/// Modules without checkpoint support ignore the request.
+void ac_module::RequestCheckpoint()
+{
+}
+
+void ac_module::RequestAllCheckpoints()
+{
+  std::list<ac_module*>::iterator i;
+
+  for (i = mods_list.begin(); i != mods_list.end(); i++)
+    (*i)->RequestCheckpoint();
+}
+
 /// Public method that registers module as a running module.
 void ac_module::set_running() {
+  ac_host_lock guard;
   running_mods++;
 }
 
 /// Public method that unregisters module (ie, it's no longer running).
 void ac_module::set_stopped() {
+  if (cosim)
+    cosim->stopped(*this);
+
+  ac_host_lock guard;
   if (--running_mods == 0) {
+    if (on_host_thread()) {
+      // sc_stop() must be called by the kernel, see host_behavior()
+      host_stop = true;
+      return;
+    }
     dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
     sc_stop();
   }
@@ -134,3 +188,160 @@ void ac_module::set_proc_freq(unsigned int proc_freq_mhz) {
   module_period_ns=1000/proc_freq_mhz;
 }
 
+/// Processor behavior placeholder.
+void ac_module::behavior()
+{
+  return;
+}
+
+/// Enables running every module behavior on its own host thread.
+void ac_module::set_parallel(bool enable)
+{
+  parallel = enable;
+}
+
+/// Returns whether the caller is a module host thread.
+bool ac_module::on_host_thread()
+{
+  return current_host_module != NULL;
+}
+
+/// Locks the shared resources. Host threads only get them while the
+/// SystemC kernel is blocked waiting for one of them.
+void ac_module::host_lock()
+{
+  pthread_mutex_lock(&host_mutex);
+  while (kernel_running)
+    pthread_cond_wait(&host_free, &host_mutex);
+}
+
+/// Unlocks the shared resources.
+void ac_module::host_unlock()
+{
+  pthread_mutex_unlock(&host_mutex);
+}
+
+/// Host thread entry point.
+void* ac_module::host_entry(void* arg)
+{
+  ac_module* mod = static_cast<ac_module*>(arg);
+
+  current_host_module = mod;
+  mod->behavior();
+
+  pthread_mutex_lock(&host_mutex);
+  mod->host_state = HOST_DONE;
+  pthread_cond_broadcast(&mod->host_cond);
+  pthread_mutex_unlock(&host_mutex);
+  return NULL;
+}
+
+/// Hands a request to the SystemC thread and waits to be resumed.
+void ac_module::host_yield(host_state_t state)
+{
+  pthread_mutex_lock(&host_mutex);
+  host_state = state;
+  pthread_cond_broadcast(&host_cond);
+  while (host_state != HOST_RUN)
+    pthread_cond_wait(&host_cond, &host_mutex);
+  pthread_mutex_unlock(&host_mutex);
+}
+
+/// SystemC thread of the module.
+void ac_module::host_behavior()
+{
+  if (!parallel) {
+    behavior();
+    return;
+  }
+
+  host_state = HOST_RUN;
+  if (pthread_create(&host_thread, NULL, host_entry, this) != 0) {
+    std::cerr << "ArchC: Could not create the host thread for " << name()
+              << ", running serially." << std::endl;
+    behavior();
+    return;
+  }
+
+  for (;;) {
+    // Let the other modules resume their host threads before blocking
+    wait(SC_ZERO_TIME);
+
+    pthread_mutex_lock(&host_mutex);
+    kernel_running = false;
+    pthread_cond_broadcast(&host_free);
+    while (host_state == HOST_RUN)
+      pthread_cond_wait(&host_cond, &host_mutex);
+    kernel_running = true;
+    pthread_mutex_unlock(&host_mutex);
+
+    if (host_state == HOST_DONE)
+      break;
+
+    if (host_state == HOST_SYNC)
+      ac_qk.sync();
+    else if (host_state == HOST_CALL)
+      host_fn(host_arg);
+    else
+      wait(*host_event);
+
+    pthread_mutex_lock(&host_mutex);
+    host_state = HOST_RUN;
+    pthread_cond_broadcast(&host_cond);
+    pthread_mutex_unlock(&host_mutex);
+  }
+
+  pthread_join(host_thread, NULL);
+
+  if (host_stop) {
+    host_stop = false;
+    dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
+    sc_stop();
+  }
+}
+
+/// Synchronizes the quantum keeper with the SystemC time.
+void ac_module::host_sync()
+{
+  if (current_host_module == this)
+    host_yield(HOST_SYNC);
+  else
+    ac_qk.sync();
+}
+
+/// Waits for a SystemC event from the calling behavior.
+void ac_module::host_wait(sc_event& e)
+{
+  ac_module* mod = current_host_module;
+
+  if (mod) {
+    mod->host_event = &e;
+    mod->host_yield(HOST_WAIT);
+  }
+  else
+    sc_core::wait(e);
+}
+
+/// Calls fn(arg) on the SystemC thread of the calling module. The host
+/// thread already holds host_mutex (ac_host_lock): it waits on it, letting
+/// the kernel run the call, and takes the shared resources back once the
+/// kernel blocks again.
+void ac_module::host_call(void (*fn)(void*), void* arg)
+{
+  ac_module* mod = current_host_module;
+
+  if (!mod) {
+    fn(arg);
+    return;
+  }
+
+  mod->host_fn = fn;
+  mod->host_arg = arg;
+  mod->host_state = HOST_CALL;
+  pthread_cond_broadcast(&mod->host_cond);
+  while (mod->host_state != HOST_RUN)
+    pthread_cond_wait(&mod->host_cond, &host_mutex);
+  while (kernel_running)
+    pthread_cond_wait(&host_free, &host_mutex);
+}
+
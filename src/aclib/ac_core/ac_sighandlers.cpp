@@ -53,6 +53,12 @@ void sigusr1_handler(int signal)
   fprintf(stderr, "ArchC: -------------------- Continuing Simulation ------------------\n");
 }
 
+void sigcheckpoint_handler(int signal)
+{
+  fprintf(stderr, "ArchC: Received signal %d. Taking a checkpoint\n", signal);
+  ac_module::RequestAllCheckpoints();
+}
+
 void sigusr2_handler(int signal)
 {
   fprintf(stderr, "ArchC: Received signal %d. Starting GDB support (not implemented).\n", signal);
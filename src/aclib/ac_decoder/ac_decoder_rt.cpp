@@ -40,6 +40,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <vector>
+#include <algorithm>
 #include "ac_decoder_rt.H"
 
 using std::cerr;
@@ -307,6 +309,166 @@ ac_decoder* ac_decoder::AddToDecoder(ac_decoder* decoder, ac_dec_instr* instruct
   return base;
 }
 
+/* Checks whether a value to be checked can ever be read from a field.
+   \return 1 if the field can hold the value, 0 otherwise
+*/
+static int ValueFits(const ac_dec_table_field& field, long long value)
+{
+  if (field.size >= 64)
+    return 1;
+  if (field.sign)
+    return (field.size > 0) && (value >= -(1LL << (field.size - 1))) && (value < (1LL << (field.size - 1)));
+  return (value >= 0) && ((unsigned long long) value <= field.mask);
+}
+
+static bool EntryLess(const ac_dec_table_entry& e1, const ac_dec_table_entry& e2)
+{
+  return e1.value < e2.value;
+}
+
+/* Builds the decode table levels for the decoder list starting at d.
+   Consecutive nodes checking the same field become a single level, so the
+   order in which the tree walk tried them is kept through the alternatives.
+   \return index of the first level, -1 if d is NULL
+*/
+static int BuildLevels(ac_decoder* d, ac_dec_table_field* table_fields,
+                       std::vector<ac_dec_table_level>& levels,
+                       std::vector<int>& operands, int depth)
+{
+  int first = -1, previous = -1;
+
+  if (d && depth >= ac_decoder_full::MAX_DEPTH) {
+    fprintf(stderr, "Error: Decoder is deeper than %d levels.\n", ac_decoder_full::MAX_DEPTH);
+    exit(1);
+  }
+
+  while (d) {
+    ac_dec_table_level level;
+    ac_dec_table_field& field = table_fields[d->check->id];
+    std::vector<ac_dec_table_entry> entries;
+    int index = levels.size();
+    int i;
+
+    // Reserve the slot now, sub levels are appended while this one is built
+    levels.push_back(level);
+
+    level.field = d->check->id;
+    level.alternative = -1;
+
+    for (; d && d->check->id == level.field; d = d->next) {
+      ac_dec_table_entry entry;
+
+      if (!ValueFits(field, d->check->value))
+        continue;
+
+      entry.value = (unsigned long long) (long long) d->check->value & field.mask;
+      for (i = 0; i < (int) entries.size() && entries[i].value != entry.value; i++);
+      if (i < (int) entries.size())
+        continue;
+
+      entry.found = d->found;
+      entry.next = -1;
+      entry.operands = -1;
+
+      if (d->found) {
+        // Remaining fields are only extracted as operands
+        entry.operands = operands.size();
+        for (ac_decoder* o = d->subcheck; o; o = o->subcheck)
+          operands.push_back(o->check->id);
+        operands.push_back(0);
+      }
+      else
+        entry.next = BuildLevels(d->subcheck, table_fields, levels, operands, depth + 1);
+
+      entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), EntryLess);
+    level.nEntries = entries.size();
+    level.entries = new ac_dec_table_entry[level.nEntries];
+    for (i = 0; i < level.nEntries; i++)
+      level.entries[i] = entries[i];
+
+    // Small fields, or densely used ones, are looked up directly
+    level.bits = 0;
+    level.slots = NULL;
+    if ((field.size > 0) && ((field.size <= 8) || ((field.size <= 16) && ((1 << field.size) <= 32 * level.nEntries)))) {
+      level.bits = field.size;
+      level.slots = new int[1 << level.bits];
+      for (i = 0; i < (1 << level.bits); i++)
+        level.slots[i] = -1;
+      for (i = 0; i < level.nEntries; i++)
+        level.slots[level.entries[i].value] = i;
+    }
+
+    levels[index] = level;
+    if (previous >= 0)
+      levels[previous].alternative = index;
+    else
+      first = index;
+    previous = index;
+  }
+
+  return first;
+}
+
+// Builds the decode tables from the decoder tree
+void ac_decoder_full::CreateTable()
+{
+  std::vector<ac_dec_table_level> table;
+  std::vector<int> ops;
+  ac_dec_format *format;
+  ac_dec_field *field;
+  unsigned id;
+
+  // The bits shared by every format are read at once, and fields lying
+  // inside them are extracted with a shift and a mask
+  prefix_bits = 64;
+  for (format = formats; format; format = format->next)
+    if (format->size < prefix_bits)
+      prefix_bits = format->size;
+
+  table_fields = new ac_dec_table_field[nFields];
+  for (id = 0; id < nFields; id++) {
+    table_fields[id].first_bit = 0;
+    table_fields[id].size = 0;
+    table_fields[id].sign = 0;
+    table_fields[id].mask = 0;
+    table_fields[id].shift[0] = table_fields[id].shift[1] = -1;
+  }
+
+  for (field = (nFields > 1) ? fields : NULL; field; field = field->next) {
+    ac_dec_table_field& t = table_fields[field->id];
+    int first = field->first_bit - (field->size - 1);
+
+    t.first_bit = field->first_bit;
+    t.size = field->size;
+    t.sign = field->sign;
+    t.mask = (field->size >= 64) ? ~0ULL : (1ULL << field->size) - 1;
+
+    if ((field->size > 0) && (field->size <= 32) && (first >= 0) && (field->first_bit < prefix_bits)) {
+      t.shift[0] = prefix_bits - 1 - field->first_bit;  // big-endian
+      t.shift[1] = first;                               // little-endian
+    }
+  }
+
+  BuildLevels(decoder, table_fields, table, ops, 0);
+
+  levels = NULL;
+  if (table.size()) {
+    levels = new ac_dec_table_level[table.size()];
+    for (id = 0; id < table.size(); id++)
+      levels[id] = table[id];
+  }
+
+  operands = NULL;
+  if (ops.size()) {
+    operands = new int[ops.size()];
+    for (id = 0; id < ops.size(); id++)
+      operands[id] = ops[id];
+  }
+}
+
 // ac_decoder_full static method, or constructor? :-D
 ac_decoder_full *ac_decoder_full::CreateDecoder(ac_dec_format *formats, ac_dec_instr *instructions, ac_dec_prog_source* source)
 {
@@ -351,80 +513,91 @@ ac_decoder_full *ac_decoder_full::CreateDecoder(ac_dec_format *formats, ac_dec_i
   full -> instructions = instructions;
   full -> nFields = nFields;
   full -> prog_source = source;
+  full -> CreateTable();
   
   return full;
 }
 
-unsigned* ac_decoder_full::Decode(unsigned char *buffer, int quant)
+inline unsigned long long ac_decoder_full::GetField(const ac_dec_table_field& field, int order, unsigned long long prefix,
+                                                    unsigned char* buffer, int* quant) const
 {
-  ac_decoder_full *decoder = this;
-  ac_decoder *d = decoder -> decoder;
-  ac_dec_field *field = 0;
-  long long field_value = 0;
-  ac_dec_instr *instruction = NULL;
-  //char byte;
-  static unsigned *fields = 0;
-
-  ac_decoder *chosenPath[64]; // usar uma constante = MAX_DECODER_DEPTH
-  int chosenPathPos = 0;
-  chosenPath[chosenPathPos] = d;
-
- //!Allocate the first time only
-  if (!fields) {
-    fields = new unsigned[decoder -> nFields];
+  int shift = (order >= 0) ? field.shift[order] : -1;
+  unsigned long long value;
+
+  if (shift < 0)
+    return prog_source->GetBits(buffer, quant, field.first_bit, field.size, field.sign);
+
+  value = (prefix >> shift) & field.mask;
+
+  //If signed, sign extend if necessary
+  if (field.sign && (value >> (field.size - 1)))
+    value |= (~0ULL) << field.size;
+
+  return value;
+}
+
+inline int ac_decoder_full::FindEntry(const ac_dec_table_level& level, unsigned long long value)
+{
+  int low = 0, high = level.nEntries - 1;
+
+  if (level.bits)
+    return level.slots[value];
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    if (level.entries[middle].value == value)
+      return middle;
+    if (level.entries[middle].value < value)
+      low = middle + 1;
+    else
+      high = middle - 1;
   }
 
-  while (d) {
-    if (!field) {
-      field = decoder->fields->FindDecField(d -> check -> id);
-      field_value = decoder->prog_source->GetBits(buffer, &quant, field -> first_bit, field -> size, field -> sign);
-    }
+  return -1;
+}
+
+unsigned* ac_decoder_full::Decode(unsigned char *buffer, int quant, unsigned* fields) const
+{
+  unsigned long long prefix = 0;
+  int order = prog_source->GetBitOrder();
+
+  int path[MAX_DEPTH];   // alternatives to try when backtracking
+  int depth = 0;
+  int level = levels ? 0 : -1;
 
-    //fprintf(stderr, "Decoder - FieldName: %s ValueRequired: %d ValueFound: %d\n",
-    //        d -> check -> name, d -> check -> value, field_value);
-
-    if (field_value == d -> check -> value) {
-      if (d -> found) {
-        //fprintf(stderr, "Instruction %s has been found.\n", d -> found -> name);
-        fields[d->check->id] = field_value;
-        instruction = d->found;
-        break;
-      } else {
-        //fprintf(stderr, "Following d -> subcheck branch in the decoder tree. \n");
-        chosenPath[++chosenPathPos] = d -> subcheck;
-        fields[d->check->id] = field_value;
-        d = d -> subcheck;
-        field = 0;
+  if ((order >= 0) && (prefix_bits > 0) && levels)
+    prefix = prog_source->GetBits(buffer, &quant, prefix_bits - 1, prefix_bits, 0);
+
+  while (level >= 0) {
+    const ac_dec_table_level& l = levels[level];
+    const ac_dec_table_field& field = table_fields[l.field];
+    unsigned long long field_value = GetField(field, order, prefix, buffer, &quant);
+    int e = FindEntry(l, field_value & field.mask);
+
+    if (e >= 0) {
+      const ac_dec_table_entry& entry = l.entries[e];
+
+      fields[l.field] = field_value;
+
+      /* If found, extract operands from instruction */
+      if (entry.found) {
+        for (const int* op = operands + entry.operands; *op; op++)
+          fields[*op] = GetField(table_fields[*op], order, prefix, buffer, &quant);
+        fields[0] = entry.found->id;
+        return fields;
       }
-    } else {
-      //fprintf(stderr, "Following d->next branch in the decoder tree. \n");
-      chosenPath[chosenPathPos] = d -> next;
-      d = d -> next;
-      if (d && d -> check -> id != field -> id)
-        field=0;
-    }
 
-    while ((d == NULL) && (chosenPathPos > 0)) {
-      //fprintf(stderr, "Backtracking in the decoder tree.\n");
-      d = chosenPath[--chosenPathPos];
-      chosenPath[chosenPathPos] = d -> next;
-      d = d -> next;
-      if (d && d -> check -> id != field -> id)
-        field = 0;
+      if (entry.next >= 0) {
+        path[depth++] = l.alternative;
+        level = entry.next;
+        continue;
+      }
     }
-  }
 
-  /* If found, extract operands from instruction */
-  if (instruction != NULL) {
-    d = d->subcheck;
-    while (d) {
-      field = decoder->fields->FindDecField(d -> check -> id);
-      field_value = decoder->prog_source->GetBits(buffer, &quant, field -> first_bit, field -> size, field -> sign);
-      fields[d->check->id] = field_value;
-      d = d->subcheck;
-    }
-    fields[0] = instruction->id;
-    return fields;
+    // Backtracking in the decode table
+    level = l.alternative;
+    while ((level < 0) && (depth > 0))
+      level = path[--depth];
   }
 
   return NULL;
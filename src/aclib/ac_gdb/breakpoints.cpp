@@ -137,20 +137,24 @@ int Breakpoints::remove(unsigned int address) {
  * \return 1 if there is a breakpoint, 0 otherwise
  */
 int Breakpoints::exists(unsigned int address) {
-  int i;
+  int low, high, middle;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( ( ! bp ) || ( quant == 0 ) )
     return 0;
 
-  for ( i = 0; i < quant; i ++ )
-    if ( address == bp[ i ] )
-      return 1;
-    else
-      /* bp is crescent order, so if current element is greater than desired
-       * address, there's no address in list
-       */
-      if (  bp[ i ] > address )
-	return 0;
+  /* bp is in crescent order: binary search */
+  low  = 0;
+  high = quant - 1;
+  while ( low <= high )
+    {
+      middle = ( low + high ) / 2;
+      if ( bp[ middle ] == address )
+	return 1;
+      if ( bp[ middle ] < address )
+	low = middle + 1;
+      else
+	high = middle - 1;
+    }
 
   return 0;
 }
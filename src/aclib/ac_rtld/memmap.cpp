@@ -39,6 +39,9 @@
 #include <stdio.h> 
 #include <unistd.h>
 
+#include <vector>
+#include <string>
+
 #include "memmap.H"
 
 //#define DEBUG_MEMORY
@@ -371,4 +374,43 @@ namespace ac_dynlink {
     return addr;
     
   }
+
+  /*
+     Checkpoint support: memsize, brkaddr and newbrkaddr, then one
+     address/status pair per node
+   */
+  void memmap::save(ac_checkpoint_writer& ckpt, const char* key) {
+    std::vector<Elf32_Word> state;
+
+    state.push_back(memsize);
+    state.push_back(brkaddr);
+    state.push_back(newbrkaddr);
+    for (memmap_node *aux = list; aux != NULL; aux = aux->get_next()) {
+      state.push_back(aux->get_addr());
+      state.push_back(aux->get_status());
+    }
+    ckpt.save(key, &state[0], state.size() * sizeof(Elf32_Word));
+  }
+
+  bool memmap::restore(ac_checkpoint_reader& ckpt, const char* key) {
+    std::string data;
+    const Elf32_Word *state;
+    unsigned count;
+
+    if (!ckpt.restore_data(key, data))
+      return false;
+    count = data.size() / sizeof(Elf32_Word);
+    if (count < 5 || (count % 2) == 0)
+      return false;
+    state = (const Elf32_Word *) data.data();
+
+    memsize = state[0];
+    brkaddr = state[1];
+    newbrkaddr = state[2];
+    free_memmap();
+    for (unsigned i = count - 2; i >= 3; i -= 2)
+      list = new memmap_node(list, (memmap_status) state[i + 1], state[i]);
+    return true;
+  }
+
 }
@@ -32,16 +32,27 @@
 
 #include "ac_storage.H"
 
+#include <sys/mman.h>
+
 // constructor
+// The data is mapped rather than allocated: it is page aligned, which lets
+// a checkpoint restore map pages from the checkpoint file, and the host
+// only provides the pages the program touches.
 ac_storage::ac_storage(string nm, uint32_t sz) :
   name(nm),
   size(sz) {
-  data.ptr8 = new unsigned char[sz];
+  void* p = mmap(NULL, sz ? sz : 1, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  data.ptr8 = (p == MAP_FAILED) ? new unsigned char[sz] : (unsigned char*) p;
+  mapped = (p != MAP_FAILED);
 }
 
 // destructor
 ac_storage::~ac_storage() {
-  delete[] data.ptr8;
+  if (mapped)
+    munmap(data.ptr8, size ? size : 1);
+  else
+    delete[] data.ptr8;
 }
 
 // getters and setters
@@ -191,6 +202,25 @@ void ac_storage::write(ac_ptr buf, uint32_t address,
 }
 
 
+// The whole storage may be accessed directly, and it is never revoked
+bool ac_storage::get_direct_mem_ptr(uint32_t address, ac_direct_mem& region,
+                                    ac_direct_mem_user* user) {
+  region.ptr = data.ptr8;
+  region.start = 0;
+  region.end = size - 1;
+  region.read = region.write = true;
+  return (size != 0);
+}
+
+// Checkpoint support
+void ac_storage::save(ac_checkpoint_writer& ckpt, const char* key) {
+  ckpt.save_memory(key, data.ptr8, size);
+}
+
+bool ac_storage::restore(ac_checkpoint_reader& ckpt, const char* key) {
+  return ckpt.restore_memory(key, data.ptr8, size);
+}
+
 /** 
  * Locks the device.
  * 
@@ -21,14 +21,15 @@
 
 
 // Standard includes
+#include <string.h>
 
 // SystemC includes
 
 // ArchC includes
 #include "ac_tlm2_nb_port.H"
+#include "ac_module.H"
 #include "ac_tlm2_payload.H"
 
-
 // If you want to debug TLM 2.0, please uncomment the next line
 
 //#define debugTLM2 
@@ -44,7 +45,6 @@
 ac_tlm2_nb_port::ac_tlm2_nb_port(char const* nm, uint32_t sz) : name(nm), size(sz), LOCAL_init_socket() {
 
   LOCAL_init_socket.register_nb_transport_bw(this, &ac_tlm2_nb_port::nb_transport_bw);
-  //payload_global = new ac_tlm2_payload();
 
 }
 
@@ -57,17 +57,18 @@ tlm::tlm_sync_enum  ac_tlm2_nb_port::nb_transport_bw(ac_tlm2_payload &payload, t
 	#endif
 
 	/******/
- 	payload_global = new ac_tlm2_payload();
- 	
+	/* The payload may belong to the target, keep a copy of the data */
+	unsigned length = payload.get_data_length();
 
-	unsigned char* data_pointer = payload.get_data_ptr();		 
-	payload_global->set_data_ptr(data_pointer);
-    
+	if (length > sizeof(response_data))
+	{
+		printf("\nAC_TLM2_NB_PORT NB_TRANSPORT_BW: data length-->%d not supported", length);
+		exit(0);
+	}
+	memcpy(response_data, payload.get_data_ptr(), length);
 
- 	payload_global->deep_copy_from(payload);
-	
  	#ifdef debugTLM2
-	printf("\nAC_TLM2_NB_PORT NB_TRANSPORT_BW: command-->%d  data-->%d payload_global data->%d address-->%ld",payload_global->get_command(),*data_pointer,*(payload_global->get_data_ptr()),addr);        
+	printf("\nAC_TLM2_NB_PORT NB_TRANSPORT_BW: command-->%d  data-->%d address-->%ld",payload.get_command(),response_data[0],(long)payload.get_address());
 	printf("\nNotifying a event in BW TRANSPORT");
         #endif
 
@@ -81,6 +82,67 @@ tlm::tlm_sync_enum  ac_tlm2_nb_port::nb_transport_bw(ac_tlm2_payload &payload, t
 
 
 //////////////////////////////////////////////////////////////////////////////
+/** 
+ * Forwards a transaction to the target. Serialized with the other
+ * processors when they run on host threads: the call is made holding
+ * ac_host_lock, so nb_transport_fw() must not wait(), as TLM 2.0 requires.
+ * 
+ */
+tlm::tlm_sync_enum ac_tlm2_nb_port::transport_fw(ac_tlm2_payload &payload, tlm::tlm_phase &phase, sc_core::sc_time &time)
+{
+  ac_host_lock guard;
+  return LOCAL_init_socket->nb_transport_fw(payload, phase, time);
+}
+
+/** 
+ * Takes a request payload from the pool. The caller owns one reference,
+ * given back by transact().
+ * 
+ */
+ac_tlm2_payload* ac_tlm2_nb_port::new_request(tlm::tlm_command command, uint32_t address,
+                                              unsigned char* data, unsigned length, unsigned int procId)
+{
+	ac_host_lock guard;
+	ac_tlm2_payload* request = pool.allocate();
+
+	request->acquire();
+	request->set_command(command);
+	request->set_address((sc_dt::uint64)address);
+	request->set_data_ptr(data);
+	request->set_data_length(length);
+	request->set_byte_enable_ptr(0);
+	request->set_dmi_allowed(false);
+	request->set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+	/** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
+	request->set_streaming_width((const unsigned int)procId);
+	/**/
+
+	return request;
+}
+
+/** 
+ * Sends a request and waits for its response, whose data nb_transport_bw
+ * leaves in response_data. The request goes back to the pool once the
+ * target releases it too.
+ * 
+ */
+void ac_tlm2_nb_port::transact(ac_tlm2_payload* request, sc_core::sc_time &time_info, const char* error)
+{
+	tlm::tlm_phase phase = tlm::BEGIN_REQ;
+
+	if (transport_fw(*request, phase, time_info) != tlm::TLM_UPDATED)
+	{
+		printf("\n%s", error);
+		exit(0);
+	}
+
+	ac_module::host_wait(this->wake_up);
+
+	ac_host_lock guard;
+	request->release();
+}
+
 /** 
  * Reads a single word.
  * 
@@ -92,97 +154,37 @@ tlm::tlm_sync_enum  ac_tlm2_nb_port::nb_transport_bw(ac_tlm2_payload &payload, t
 void ac_tlm2_nb_port::read(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_time &time_info,unsigned int procId)
 
 {
-
-	payload_global = new ac_tlm2_payload();
-
-	tlm::tlm_phase phase = tlm::BEGIN_REQ;
-	tlm::tlm_sync_enum status;
-
-  	//sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
 	unsigned char p[32];
 
-	payload_global->set_command(tlm::TLM_READ_COMMAND);
-	payload_global->set_address((sc_dt::uint64)address);
-	payload_global->set_data_ptr(p);
-	
-    if (wordsize == 8) payload_global->set_data_length(sizeof(uint8_t));
-    else if (wordsize == 16) payload_global->set_data_length(sizeof(uint16_t));
-    else if (wordsize == 32) payload_global->set_data_length(sizeof(uint32_t));
-	else {
+	if ((wordsize != 8) && (wordsize != 16) && (wordsize != 32))
+	{
 		printf("\n\nAC_TLM2_NB_PORT READ: wordsize not implemented");
 		exit(0);
 	}
 
- 	/** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
-    payload_global->set_streaming_width((const unsigned int)procId);
-    /**/
-
 	#ifdef debugTLM2 
 	printf("\n\n*******AC_TLM2_NB_PORT READ: command-->%d address-->%ld",tlm::TLM_READ_COMMAND, address);
 	#endif
 
-	/**********
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
+	transact(new_request(tlm::TLM_READ_COMMAND, address, p, wordsize / 8, procId),
+	         time_info, "AC_TLM2_NB_PORT READ ERROR");
 
-	status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info);
-	if(status != tlm::TLM_UPDATED)
+	switch (wordsize) 
 	{
-		printf("\nAC_TLM2_NB_PORT READ ERROR");
-		exit(0);
+	  case 8:
+		*(buf.ptr8) = response_data[0];
+		break;
+	  case 16:
+		*(buf.ptr16) = *((uint16_t*)response_data);
+		break;
+	  case 32:
+		*(buf.ptr32) = *((uint32_t*)response_data);
+		break;
 	}
 
-	/**** TENTATIVA PARA EVITAR MEMORY LEAK*/
-	delete payload_global;
-
-
-	wait(this->wake_up);
-	
-	
-	uint8_t data8;
-	uint16_t data16;
-	uint32_t data32;
-
-	   switch (wordsize) 
-	   {
-	      case 8:
-	       	data8 = *((uint8_t*)payload_global->get_data_ptr());
-		*(buf.ptr8) = ((uint8_t*)&data8)[0];
-	        #ifdef debugTLM2 
-		printf("\nAC_TLM2_NB_PORT READ: wordsize-->%d  data8-->%d data-->%d, address-->%ld",wordsize,data8,*(payload_global->get_data_ptr()),payload_global->get_address());
-		#endif
-	       	break;
-
-	      case 16:
-	      
-		data16 = *((uint16_t*)payload_global->get_data_ptr());
-		*(buf.ptr16) = ((uint16_t*)&data16)[0];
-
-	  	#ifdef debugTLM2 
-                printf("\nAC_TLM2_NB_PORT READ: wordsize-->%d  data16-->%d data-->%d, address-->%ld",wordsize,data16,*(payload_global->get_data_ptr()),payload_global->get_address());
-		#endif
-                break;
-	      case 32:
-	       
-		data32 = *((uint32_t*)payload_global->get_data_ptr());
-
-		*(buf.ptr32) = ((uint32_t*)&data32)[0];
-
-        	#ifdef debugTLM2 
-		printf("\nAC_TLM2_NB_PORT READ: wordsize-->%d  data32-->%d data-->%d, address-->%ld",wordsize,data32,*(payload_global->get_data_ptr()),payload_global->get_address());
-		#endif
-        	break;
-	      case 64:
-	      default:
-        	printf("*** AC_TLM2_NB_PORT READ: wordsize-->%d not supported ****", wordsize);
-		exit(0);
-	        break;
-	   }
-
-	
-	delete payload_global;
- 	
+	#ifdef debugTLM2 
+	printf("\nAC_TLM2_NB_PORT READ: wordsize-->%d  data-->%d, address-->%ld",wordsize,response_data[0],address);
+	#endif
 }
 
 /* read n_words */
@@ -190,132 +192,26 @@ void ac_tlm2_nb_port::read(ac_ptr buf, uint32_t address, int wordsize,sc_core::s
 void ac_tlm2_nb_port::read(ac_ptr buf, uint32_t address,
                          int wordsize, int n_words,sc_core::sc_time &time_info,unsigned int procId) {
 
-	payload_global = new ac_tlm2_payload();
-
-	tlm::tlm_phase phase = tlm::BEGIN_REQ;
-	tlm::tlm_sync_enum status;
+	unsigned char p[32];
+	unsigned bytes = wordsize / 8;
 
-	//sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
-	payload_global->set_command(tlm::TLM_READ_COMMAND);
-	
-	/** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
-    payload_global->set_streaming_width((const unsigned int)procId);
-    /**/
+	if ((wordsize != 8) && (wordsize != 16) && (wordsize != 32))
+	{
+		printf("\n\nAC_TLM2_NB_PORT READ: wordsize not implemented");
+		exit(0);
+	}
 
-	unsigned char p[32];
-	int i;
-	
 	#ifdef debugTLM2 
 	printf("\n\n*******AC_TLM2_NB_PORT READ N_WORDS: wordsize--> %d command-->%d address-->%ld",wordsize,tlm::TLM_READ_COMMAND, address);
 	#endif
 
-	/**********
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
-
-
-	switch (wordsize) 
+	for (int i = 0; i < n_words; i++)
 	{
-	    case 8:
-   	       
-		for( i=0; i<n_words; i++)
-  		{	
-			payload_global->set_address(address +i);
-			payload_global->set_data_length(sizeof(uint8_t));
-			payload_global->set_data_ptr(p);
-
-			status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-			if(status != tlm::TLM_UPDATED)
-			{
-				printf("\nAC_TLM2_NB_PORT n_words READ ERROR");
-				exit(0);
-			}
-			
-			/**** TENTATIVA PARA EVITAR MEMORY LEAK*/
-			delete payload_global;
-
-			wait(this->wake_up);
-			
-	
-			unsigned char* data_pointer = payload_global->get_data_ptr();		
-
-			for (int j = 0; (i < n_words) && (j < 4); j++, i++) {
-				(buf.ptr8)[i] = ((uint8_t*)data_pointer)[j];
-			}
-			i--;
-			
-   		}
-		break;
-   
- 	  case 16:
-		for( i=0; i<n_words; i++)
-  		{
-			payload_global->set_address(address + (i * sizeof(uint16_t)));
-			payload_global->set_data_length(sizeof(uint16_t));
-			payload_global->set_data_ptr(p);
-
-			status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-			if(status != tlm::TLM_UPDATED)
-			{
-				printf("\nAC_TLM2_NB_PORT n_words READ ERROR");
-				exit(0);
-			}
-
-			/**** TENTATIVA PARA EVITAR MEMORY LEAK*/
-			delete payload_global;
-
-	
-			wait(this->wake_up);
-
-    		unsigned char* data_pointer = payload_global->get_data_ptr();
-
-
-			for (int j = 0; (i < n_words) && (j < 4); j++, i++) {
-				buf.ptr16[i] = ((uint16_t*)data_pointer)[j];
-			}
-			i--;
+		transact(new_request(tlm::TLM_READ_COMMAND, address + i * bytes, p, bytes, procId),
+		         time_info, "AC_TLM2_NB_PORT n_words READ ERROR");
 
-		}
-       		break;
-	  case 32:
-		
-		for( i=0; i<n_words; i++)
-  		{	
-			payload_global->set_address(address + (i * sizeof(uint32_t)));
-			payload_global->set_data_length(sizeof(uint32_t));
-		        payload_global->set_data_ptr(p);
-
-			status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-			if(status != tlm::TLM_UPDATED)
-			{
-				printf("\nAC_TLM2_NB_PORT n_words READ ERROR");
-				exit(0);
-			}
-	
-
-			/**** TENTATIVA PARA EVITAR MEMORY LEAK*/
-			delete payload_global;
-
-
-			wait(this->wake_up);
-
-			unsigned char* data_pointer = payload_global->get_data_ptr();
-			
-			buf.ptr32[i] = *((uint32_t*)data_pointer);
-
-   		}	
-	
-	        break;
-  	  case 64:
-	  default:
-		printf("\n\nAC_TLM2_NB_PORT WRITE: wordsize not implemented");
-		exit(0);	
-		break;
-        }
-	 
-	delete payload_global;
- 		
+		memcpy(buf.ptr8 + i * bytes, response_data, bytes);
+	}
 }
 
 /** 
@@ -329,163 +225,43 @@ void ac_tlm2_nb_port::read(ac_ptr buf, uint32_t address,
 void ac_tlm2_nb_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_time &time_info, unsigned int procId) {
 
   unsigned char p[32];
-  
-  unsigned char *ptr;
-
-  payload_global = new ac_tlm2_payload();
-
-  tlm::tlm_phase phase = tlm::BEGIN_REQ;
-  tlm::tlm_sync_enum status;
-
-  //sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
-
 
   #ifdef debugTLM2 
   printf("\n\n*******AC_TLM2_NB_PORT WRITE: wordsize--> %d command-->%d address-->%ld",wordsize,tlm::TLM_WRITE_COMMAND, address);
   #endif
 
-   /** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
-   payload_global->set_streaming_width((const unsigned int)procId);
-   /**/
-	/**********
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
-
-
-
-
   switch (wordsize) {
   case 8:
-    payload_global->set_command(tlm::TLM_READ_COMMAND);
-    payload_global->set_address((uint64_t)address);
-    payload_global->set_data_length(sizeof(uint8_t));
-    payload_global->set_data_ptr(p);
-    
-    status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-    if(status != tlm::TLM_UPDATED)
-    {
-	printf("\nAC_TLM2_NB_PORT  WRITE ERROR");
-	exit(0);
-    }
-	
+    transact(new_request(tlm::TLM_READ_COMMAND, address, p, sizeof(uint8_t), procId),
+             time_info, "AC_TLM2_NB_PORT  WRITE ERROR");
+
     #ifdef debugTLM2 
     printf("\n\nAC_TLM2_NB_PORT WRITE is waiting for wake_up event");
     #endif
 
-    /*****/
-    delete payload_global;
-
-    wait(this->wake_up);
-
-    
-    payload_global->set_command(tlm::TLM_WRITE_COMMAND);
-
-    ptr = payload_global->get_data_ptr();
-    ((uint8_t*)ptr)[0] = *(buf.ptr8);
-
-    payload_global->set_address((uint64_t)address);
-    payload_global->set_data_ptr(ptr);
-
-    
-	/**********	
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
-
-    status =  LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-    if(status != tlm::TLM_UPDATED)
-    {
-	printf("\nAC_TLM2_NB_PORT  WRITE ERROR");
-	exit(0);
-    }
-
-	/*****/
-    delete payload_global;
-
-    wait(this->wake_up);
-    
-
-	
+    p[0] = *(buf.ptr8);
 
+    transact(new_request(tlm::TLM_WRITE_COMMAND, address, p, sizeof(uint8_t), procId),
+             time_info, "AC_TLM2_NB_PORT  WRITE ERROR");
     break;
-  case 16:
-    payload_global->set_command(tlm::TLM_READ_COMMAND);
-    payload_global->set_address((uint64_t)address);
-    payload_global->set_data_length(sizeof(uint16_t));
-    payload_global->set_data_ptr(p);
-
-    status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-    if(status != tlm::TLM_UPDATED)
-    {
-	printf("\nAC_TLM2_NB_PORT  WRITE ERROR");
-	exit(0);
-    }
-	
-
-	/*****/
-    delete payload_global;
-
-    wait(this->wake_up);
-    
-    payload_global->set_command(tlm::TLM_WRITE_COMMAND);
-    ptr = payload_global->get_data_ptr();
-
-    ((uint16_t*)ptr)[0] = *(buf.ptr16);
-    payload_global->set_address((uint64_t)address);
-    payload_global->set_data_ptr(ptr);
-
-	/**********	
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
 
+  case 16:
+    transact(new_request(tlm::TLM_READ_COMMAND, address, p, sizeof(uint16_t), procId),
+             time_info, "AC_TLM2_NB_PORT  WRITE ERROR");
 
-    status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-    if(status != tlm::TLM_UPDATED)
-    {
-	printf("\nAC_TLM2_NB_PORT  WRITE ERROR");
-	exit(0);
-    } 
-    
-    /*****/
-    delete payload_global;
-    wait(this->wake_up);
-    
+    ((uint16_t*)p)[0] = *(buf.ptr16);
 
+    transact(new_request(tlm::TLM_WRITE_COMMAND, address, p, sizeof(uint16_t), procId),
+             time_info, "AC_TLM2_NB_PORT  WRITE ERROR");
     break;
  
- case 32:
-    payload_global->set_address((uint64_t)address);
-    payload_global->set_command(tlm::TLM_WRITE_COMMAND);
-    payload_global->set_data_length(sizeof(uint32_t));
-
-    ((uint32_t*)p)[0]=*(buf.ptr32);
-
-    payload_global->set_data_ptr(p);    
-
-
-    /**********	
-	To garantee that there are no extensions in the payload
-	**********/
-	payload_global->free_all_extensions();	
-	
-    status = LOCAL_init_socket->nb_transport_fw(*payload_global, phase, time_info); 
-
-    if(status != tlm::TLM_UPDATED)
-    {
-	printf("\nAC_TLM2_NB_PORT  WRITE ERROR");
-	exit(0);
-    } 
-
-
-   /*****/
-    delete payload_global;
-    wait(this->wake_up);
-	
+  case 32:
+    ((uint32_t*)p)[0] = *(buf.ptr32);
 
+    transact(new_request(tlm::TLM_WRITE_COMMAND, address, p, sizeof(uint32_t), procId),
+             time_info, "AC_TLM2_NB_PORT  WRITE ERROR");
     break;
- 
+
   case 64:
   default:
 	printf("\n\nAC_TLM2_NB_PORT WRITE: wordsize not implemented");
@@ -493,9 +269,6 @@ void ac_tlm2_nb_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::
     break;
   }
 
-  
-  delete payload_global;
-
 }
 
 /** 
@@ -556,9 +329,6 @@ void ac_tlm2_nb_port::unlock()
  * @return Nothing.
  */
 ac_tlm2_nb_port::~ac_tlm2_nb_port() {
-
-	//delete payload_global;
- 
 }
 
 
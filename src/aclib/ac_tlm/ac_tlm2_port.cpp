@@ -32,12 +32,15 @@
  */
 
 // Standard includes
+#include <string.h>
+#include <algorithm>
 
 // SystemC includes
 
 // ArchC includes
 #include "ac_tlm2_port.H"
 #include "ac_tlm2_payload.H"
+#include "ac_module.H"
 
 // If you want to debug TLM 2.0, please uncomment the next line
 //#define debugTLM2
@@ -47,9 +50,118 @@
 ac_tlm2_port::ac_tlm2_port(char const* nm, uint32_t sz) : name(nm), size(sz) {
 
  payload = new ac_tlm2_payload();
+
+ dmi_target = NULL;
+ dmi_checked = false;
+ dmi_valid = false;
+ dmi_denied = false;
+ burst = false;
+ burst_checked = false;
  
  }
 
+//////////////////////////////////////////////////////////////////////////////
+/** 
+ * Asks the target for a DMI region covering an address. The target is
+ * asked again for addresses it refused only after an invalidation.
+ * 
+ */
+bool ac_tlm2_port::request_dmi(uint32_t address)
+{
+    if (!dmi_checked) {
+        dmi_checked = true;
+        dmi_target = dynamic_cast<ac_tlm2_dmi_target_if*>(get_interface());
+        if (dmi_target)
+            dmi_target->register_dmi_initiator(this);
+    }
+
+    if (!dmi_target)
+        return false;
+
+    if (dmi_denied && (address >= dmi_denied_start) && (address <= dmi_denied_end))
+        return false;
+
+    payload->set_command(tlm::TLM_READ_COMMAND);
+    payload->set_address((sc_dt::uint64)address);
+    dmi.init();
+
+    dmi_valid = dmi_target->get_direct_mem_ptr(*payload, dmi) &&
+                (address >= dmi.get_start_address()) && (address <= dmi.get_end_address());
+
+    if (!dmi_valid) {
+        dmi_denied = true;
+        dmi_denied_start = dmi.get_start_address();
+        dmi_denied_end = dmi.get_end_address();
+    }
+    return dmi_valid;
+}
+
+/// Arguments of a b_transport() call handed to the SystemC thread
+struct ac_tlm2_transport_args
+{
+    ac_tlm2_port* port;
+    sc_core::sc_time* time_info;
+};
+
+/** 
+ * Makes the b_transport() call of transport().
+ * 
+ */
+void ac_tlm2_port::transport_call(void* arg)
+{
+    ac_tlm2_transport_args* args = static_cast<ac_tlm2_transport_args*>(arg);
+
+    (*args->port)->b_transport(*args->port->payload, *args->time_info);
+}
+
+/** 
+ * Sends the payload to the target. b_transport() may wait(), so behaviors
+ * running on host threads make the call from their SystemC thread, giving
+ * up ac_host_lock meanwhile (see ac_module::host_call()).
+ * 
+ */
+void ac_tlm2_port::transport(sc_core::sc_time &time_info)
+{
+    ac_tlm2_transport_args args = { this, &time_info };
+
+    ac_module::host_call(transport_call, &args);
+}
+
+/** 
+ * Returns whether multi-word accesses may be sent as a single transaction.
+ * Only targets implementing ac_tlm2_burst_target_if can accept them.
+ * 
+ */
+bool ac_tlm2_port::use_burst()
+{
+    if (!burst_checked) {
+        burst_checked = true;
+        ac_tlm2_burst_target_if* target = dynamic_cast<ac_tlm2_burst_target_if*>(get_interface());
+        burst = target && target->accepts_burst();
+    }
+    return burst;
+}
+
+/** 
+ * Returns the host address of length bytes at address when they lie in a
+ * DMI region that allows the access, NULL otherwise.
+ * 
+ */
+unsigned char* ac_tlm2_port::get_dmi_ptr(uint32_t address, uint32_t length, bool write)
+{
+    sc_dt::uint64 last = (sc_dt::uint64)address + length - 1;
+
+    if (!dmi_valid || (address < dmi.get_start_address()) || (address > dmi.get_end_address()))
+        if (!request_dmi(address))
+            return NULL;
+
+    if ((last > dmi.get_end_address()) ||
+        (write ? !dmi.is_write_allowed() : !dmi.is_read_allowed()))
+        return NULL;
+
+    return dmi.get_dmi_ptr() + (address - dmi.get_start_address());
+}
+
 //////////////////////////////////////////////////////////////////////////////
 /** 
  * Reads a single word.
@@ -58,6 +170,7 @@ ac_tlm2_port::ac_tlm2_port(char const* nm, uint32_t sz) : name(nm), size(sz) {
  */
 void ac_tlm2_port::read(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_time& time_info, unsigned int procId)
 {
+    ac_host_lock guard;
     //sc_core::sc_time time_info;
     unsigned char buffer[64];
 
@@ -83,7 +196,15 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_t
     printf("\n\nAC_TLM2_PORT READ: command-->%d address-->%ld",tlm::TLM_READ_COMMAND, address);
     #endif
 
-    (*this)->b_transport(*payload, time_info);
+    unsigned char* host = get_dmi_ptr(address, payload->get_data_length(), false);
+    if (host)
+    {
+        memcpy(buf.ptr8, host, payload->get_data_length());
+        time_info += dmi.get_read_latency();
+        return;
+    }
+
+    transport(time_info);
 
     uint8_t data8;
     uint16_t data16;
@@ -137,6 +258,7 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_t
 
 void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
                          int wordsize, int n_words,sc_core::sc_time &time_info,unsigned int procId) {
+    ac_host_lock guard;
 
     //sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
     payload->set_command(tlm::TLM_READ_COMMAND);
@@ -147,6 +269,41 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
     printf("\n\nAC_TLM2_PORT READ N_WORDS: wordsize--> %d command-->%d address-->%ld",wordsize,tlm::TLM_READ_COMMAND, address);
     #endif
 
+    if ((wordsize == 8) || (wordsize == 16) || (wordsize == 32))
+    {
+        unsigned length = n_words * (wordsize / 8);
+        unsigned char* host = get_dmi_ptr(address, length, false);
+
+        if (host)
+        {
+            memcpy(buf.ptr8, host, length);
+            time_info += dmi.get_read_latency() * n_words;
+            return;
+        }
+
+        // The whole block as a single transaction
+        if (use_burst())
+        {
+            payload->set_address((sc_dt::uint64)address);
+            payload->set_data_length(length);
+            payload->set_data_ptr(buf.ptr8);
+
+            /**/
+            /** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
+            payload->set_streaming_width((const unsigned int) procId);
+            /**/
+
+            payload->set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+            transport(time_info);
+
+            if (payload->is_response_ok())
+                return;
+
+            // Targets failing the burst get one transaction per word
+            burst = false;
+        }
+    }
+
     switch (wordsize) 
     {
         case 8:
@@ -162,7 +319,7 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
                 /**/
 
 
-                (*this)->b_transport(*payload, time_info); 
+                transport(time_info); 
                 
                 for (int j = 0; (i < n_words) && (j < 4); j++, i++) {
                     (buf.ptr8)[i] = ((uint8_t*)p)[j];
@@ -183,7 +340,7 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
                 payload->set_streaming_width((const unsigned int)procId);
                 /**/
 
-                (*this)->b_transport(*payload, time_info); 
+                transport(time_info); 
                 
                 for (int j = 0; (i < n_words) && (j < 2); j++, i++) {
                     buf.ptr16[i] = ((uint16_t*)p)[j];
@@ -204,7 +361,7 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
                 payload->set_streaming_width((const unsigned int)procId);
                 /**/
 
-                (*this)->b_transport(*payload, time_info);      
+                transport(time_info);      
 
                 uint32_t *T = reinterpret_cast<uint32_t*>(p);
                 buf.ptr32[i]= T[0];
@@ -225,6 +382,7 @@ void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
  * 
   */
 void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_time &time_info,unsigned int procId) {
+    ac_host_lock guard;
 
   //sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
 
@@ -234,6 +392,18 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
   printf("\n\nAC_TLM2_PORT WRITE: wordsize--> %d command-->%d address-->%ld",wordsize,tlm::TLM_WRITE_COMMAND, address);
   #endif
 
+  if ((wordsize == 8) || (wordsize == 16) || (wordsize == 32))
+  {
+    unsigned char* host = get_dmi_ptr(address, wordsize / 8, true);
+
+    if (host)
+    {
+      memcpy(host, buf.ptr8, wordsize / 8);
+      time_info += dmi.get_write_latency();
+      return;
+    }
+  }
+
 
   switch (wordsize) {
       case 8:
@@ -249,13 +419,13 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
 
 
 
-        (*this)->b_transport(*payload, time_info); 
+        transport(time_info); 
         
         payload->set_command(tlm::TLM_WRITE_COMMAND);
         
         ((uint8_t*)p)[0] = *(buf.ptr8);
 
-        (*this)->b_transport(*payload, time_info);  
+        transport(time_info);  
       break;
       
       case 16:
@@ -271,7 +441,7 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
         /**/
 
 
-        (*this)->b_transport(*payload, time_info); 
+        transport(time_info); 
 
         payload->set_command(tlm::TLM_WRITE_COMMAND);
         
@@ -280,7 +450,7 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
 
         //((uint16_t*)p)[0] = *(buf.ptr16);
 
-        (*this)->b_transport(*payload, time_info);  
+        transport(time_info);  
       }
       break;
  
@@ -304,7 +474,7 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
 
 
         payload->set_data_ptr(p);      
-        (*this)->b_transport(*payload, time_info); 
+        transport(time_info); 
       } 
       break;
 
@@ -321,6 +491,7 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize,sc_core::sc_
  */
 void ac_tlm2_port::write(ac_ptr buf, uint32_t address,
                          int wordsize, int n_words,sc_core::sc_time &time_info,unsigned int procId) {
+    ac_host_lock guard;
 
   //sc_core::sc_time time_info = sc_core::sc_time(0, SC_NS);
   payload->set_command(tlm::TLM_WRITE_COMMAND);
@@ -331,6 +502,38 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address,
   printf("\n\nAC_TLM2_PORT WRITE N_WORDS: command-->%d address-->%ld",tlm::TLM_WRITE_COMMAND, address);
   #endif
 
+  unsigned length = n_words * sizeof(uint32_t);
+  unsigned char* host = get_dmi_ptr(address, length, true);
+
+  if (host)
+  {
+    memcpy(host, buf.ptr8, length);
+    time_info += dmi.get_write_latency() * n_words;
+    return;
+  }
+
+  // The whole block as a single transaction
+  if (use_burst())
+  {
+    payload->set_address((sc_dt::uint64)address);
+    payload->set_data_length(length);
+    payload->set_data_ptr(buf.ptr8);
+
+    /**/
+    /** IMPORTANT: The procId has been stored at the streaming_width payload field just to avoid an extention, */
+    payload->set_streaming_width((const unsigned int)procId);
+    /**/
+
+    payload->set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+    transport(time_info);
+
+    if (payload->is_response_ok())
+      return;
+
+    // Targets failing the burst get one transaction per word
+    burst = false;
+  }
+
   for(int i=0; i<n_words; i++)
   {   
     payload->set_data_length(sizeof(uint32_t));
@@ -352,11 +555,70 @@ void ac_tlm2_port::write(ac_ptr buf, uint32_t address,
     printf("\nAC_TLM2_PORT WRITE: n_words--> %d  wordsize-->%d  i--> %d command-->  data-->%d",n_words, wordsize,i, payload->get_command(), *((uint32_t*)p));
     #endif
 
-    (*this)->b_transport(*payload, time_info);  
+    transport(time_info);  
   }
 }
 
 
+/** 
+ * Requests direct access to the target.
+ * 
+ */
+bool ac_tlm2_port::get_direct_mem_ptr(uint32_t address, ac_direct_mem& region,
+                                      ac_direct_mem_user* user)
+{
+    ac_host_lock guard;
+
+    region.ptr = NULL;
+    region.start = 0;
+    region.end = 0xFFFFFFFF;
+    region.read = region.write = false;
+
+    if (user && (std::find(dmi_users.begin(), dmi_users.end(), user) == dmi_users.end()))
+        dmi_users.push_back(user);
+
+    if (!get_dmi_ptr(address, 1, false) && !get_dmi_ptr(address, 1, true)) {
+        if (dmi_denied && (address >= dmi_denied_start) && (address <= dmi_denied_end)) {
+            region.start = dmi_denied_start;
+            region.end = std::min(dmi_denied_end, (sc_dt::uint64)0xFFFFFFFF);
+        }
+        return false;
+    }
+
+    region.start = dmi.get_start_address();
+    region.end = std::min(dmi.get_end_address(), (sc_dt::uint64)0xFFFFFFFF);
+
+    // Timed regions stay on the port, which annotates their latency
+    if ((dmi.get_read_latency() != SC_ZERO_TIME) || (dmi.get_write_latency() != SC_ZERO_TIME))
+        return false;
+
+    region.ptr = dmi.get_dmi_ptr();
+    region.read = dmi.is_read_allowed();
+    region.write = dmi.is_write_allowed();
+    return true;
+}
+
+/** 
+ * Revokes the DMI regions overlapping a range, in the port and in the
+ * holders it handed them to.
+ * 
+ */
+void ac_tlm2_port::invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range)
+{
+    if (dmi_valid && (start_range <= dmi.get_end_address()) && (end_range >= dmi.get_start_address()))
+        dmi_valid = false;
+
+    if (dmi_denied && (start_range <= dmi_denied_end) && (end_range >= dmi_denied_start))
+        dmi_denied = false;
+
+    if (start_range > 0xFFFFFFFF)
+        return;
+    end_range = std::min(end_range, (sc_dt::uint64)0xFFFFFFFF);
+
+    for (unsigned i = 0; i < dmi_users.size(); i++)
+        dmi_users[i]->invalidate_direct_mem((uint32_t)start_range, (uint32_t)end_range);
+}
+
 string ac_tlm2_port::get_name() const {
   return name;
 }
@@ -40,6 +40,7 @@
 
 // ArchC includes
 #include "ac_tlm_port.H"
+#include "ac_module.H"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -65,6 +66,42 @@ ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : name(nm), size(sz) {}
 
 // Methods
 
+/// Arguments and result of a transport() call handed to the SystemC thread
+struct ac_tlm_transport_args {
+  ac_tlm_port* port;
+  const ac_tlm_req* req;
+  ac_tlm_rsp rsp;
+};
+
+/** 
+ * Makes the target call of transport().
+ * 
+ */
+void ac_tlm_port::transport_call(void* arg) {
+  ac_tlm_transport_args* args = static_cast<ac_tlm_transport_args*>(arg);
+
+  args->rsp = (*args->port)->transport(*args->req);
+}
+
+/** 
+ * Sends a request to the target. Its transport() may wait(), so behaviors
+ * running on host threads make the call from their SystemC thread, giving
+ * up ac_host_lock meanwhile (see ac_module::host_call()).
+ * 
+ * @param req Request sent.
+ * 
+ * @return The target response.
+ * 
+ */
+ac_tlm_rsp ac_tlm_port::transport(const ac_tlm_req& req) {
+  ac_tlm_transport_args args;
+
+  args.port = this;
+  args.req = &req;
+  ac_module::host_call(transport_call, &args);
+  return args.rsp;
+}
+
 /** 
  * Reads a single word.
  * 
@@ -74,6 +111,7 @@ ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : name(nm), size(sz) {}
  * 
  */
 void ac_tlm_port::read(ac_ptr buf, uint32_t address, int wordsize) {
+  ac_host_lock guard;
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
@@ -81,7 +119,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address, int wordsize) {
   req.addr = address;
   req.data = 0ULL;
 
-  rsp = (*this)->transport(req);
+  rsp = transport(req);
 
   if (rsp.status == SUCCESS) {
     switch (wordsize) {
@@ -114,6 +152,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address, int wordsize) {
  */
 void ac_tlm_port::read(ac_ptr buf, uint32_t address,
 		       int wordsize, int n_words) {
+  ac_host_lock guard;
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
@@ -125,7 +164,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + i;
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 4); i++, j++) { 
@@ -140,7 +179,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 2); i++, j++) { 
@@ -155,7 +194,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint32_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 1); i++, j++) { 
@@ -170,7 +209,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint64_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
       
       if (rsp.status == SUCCESS) {
 	(buf.ptr64)[i] = rsp.data;
@@ -191,6 +230,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
  *
  */
 void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
+  ac_host_lock guard;
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
@@ -205,23 +245,23 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
   case 8:
     req.type = READ;
     req.addr = address;
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
 
     req.type = WRITE;
     req.data = rsp.data;
     ((uint8_t*)&(req.data8))[0] = *(buf.ptr8);
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
     break;
   case 16:
     req.type = READ;
     req.addr = address;
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
 
     req.type = WRITE;
     req.data = rsp.data;
     ((uint16_t*)&(req.data16))[0] =
       *(buf.ptr16);
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
     break;
   case 32:
  //   req.type = READ;
@@ -232,7 +272,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
     //req.data = rsp.data;
     ((uint32_t*)&(req.data))[0] =
       *(buf.ptr32);
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
     break;
 
 // This is not a 64-bit operation!
@@ -240,7 +280,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
     req.type = WRITE;
     req.addr = address;
     req.data = *(buf.ptr64);
-    rsp = (*this)->transport(req);
+    rsp = transport(req);
     break;
   default:
     break;
@@ -258,6 +298,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
  */
 void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 			int wordsize, int n_words) {
+  ac_host_lock guard;
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
@@ -267,7 +308,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
       req.type = READ;
       req.addr = address + i;
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
 
       req.type = WRITE;
       req.data = rsp.data;
@@ -276,7 +317,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 	((uint8_t*)&req.data8)[j] = (buf.ptr8)[i];
       }
       i--;
-      (*this)->transport(req);
+      transport(req);
     }
     break;
   case 16:
@@ -284,7 +325,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
       req.type = READ;
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
+      rsp = transport(req);
 
       req.type = WRITE;
       req.data = rsp.data;
@@ -293,7 +334,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 	((uint16_t*)&req.data16)[j] = (buf.ptr16)[i];
       }
       i--;
-      (*this)->transport(req);
+      transport(req);
     }
     break;
   case 32:
@@ -311,14 +352,14 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 //        ((uint32_t*)&req.data)[j] = (buf.ptr32)[i];
 //      }
 //      i--;
-      (*this)->transport(req);
+      transport(req);
     }
     break;
   case 64:
     for (int i = 0; i < n_words; i++) {
       req.addr = address + (i * sizeof(uint64_t));
       req.data = (buf.ptr64)[i];
-      (*this)->transport(req);
+      transport(req);
     }
     break;
   default:
@@ -340,10 +381,11 @@ uint32_t ac_tlm_port::get_size() const {
  */
 void ac_tlm_port::lock()
 {
+  ac_host_lock guard;
   ac_tlm_req req;
   req.type = LOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  transport(req);
 }
 
 /** 
@@ -352,10 +394,11 @@ void ac_tlm_port::lock()
  */
 void ac_tlm_port::unlock()
 {
+  ac_host_lock guard;
   ac_tlm_req req;
   req.type = UNLOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  transport(req);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,576 @@
+/**
+ * @file      ac_checkpoint.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Simulator checkpoints (see ac_checkpoint.H).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "ac_checkpoint.H"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <vector>
+
+#define CKPT_ERROR(msg) std::cerr << "ArchC ERROR: checkpoint: " << msg << '\n'
+
+/// Memory section entry of a stored page.
+struct ac_checkpoint_page {
+  uint32_t page;
+  uint32_t encoding;      // 0: raw, 1: PackBits
+  uint32_t length;
+  uint32_t reserved;
+  uint64_t offset;
+};
+
+/// Upper bound on the file mappings set up by a restore, well below the
+/// per-process limit of the host.
+static const unsigned max_mappings = 16384;
+
+//////////////////////////////////////////////////////////////////////////////
+// Files opened by the simulated program
+
+struct ac_open_file {
+  std::string path;
+  int flags;
+};
+
+static std::map<int, ac_open_file> open_files;
+
+/// Processors running on host threads (--parallel) make system calls
+/// concurrently, so every access to open_files holds this mutex.
+static pthread_mutex_t open_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct open_files_lock {
+  open_files_lock() { pthread_mutex_lock(&open_files_mutex); }
+  ~open_files_lock() { pthread_mutex_unlock(&open_files_mutex); }
+};
+
+void ac_checkpoint_open_fd(int fd, const char* path, int flags)
+{
+  if (fd < 0)
+    return;
+  open_files_lock guard;
+  ac_open_file& f = open_files[fd];
+  f.path = path;
+  // Reopening must neither create nor truncate the file again
+  f.flags = flags & ~(O_CREAT | O_EXCL | O_TRUNC);
+}
+
+void ac_checkpoint_dup_fd(int fd, int newfd)
+{
+  if (newfd < 0 || newfd == fd)
+    return;
+  open_files_lock guard;
+  std::map<int, ac_open_file>::iterator i = open_files.find(fd);
+  if (i != open_files.end())
+    open_files[newfd] = i->second;
+  else
+    open_files.erase(newfd);
+}
+
+void ac_checkpoint_close_fd(int fd)
+{
+  open_files_lock guard;
+  open_files.erase(fd);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// PackBits
+
+static void pack_bits(const unsigned char* src, uint32_t len,
+                      std::vector<unsigned char>& dst)
+{
+  uint32_t i = 0;
+
+  while (i < len) {
+    uint32_t run = 1;
+    while ((i + run < len) && (run < 128) && (src[i + run] == src[i]))
+      run++;
+
+    if (run >= 3) {
+      dst.push_back((unsigned char) (257 - run));
+      dst.push_back(src[i]);
+      i += run;
+      continue;
+    }
+
+    // Literal bytes, up to the next run of 3
+    uint32_t start = i;
+    while ((i < len) && (i - start < 128)) {
+      if ((i + 2 < len) && (src[i] == src[i + 1]) && (src[i] == src[i + 2]))
+        break;
+      i++;
+    }
+    dst.push_back((unsigned char) (i - start - 1));
+    dst.insert(dst.end(), src + start, src + i);
+  }
+}
+
+static bool unpack_bits(const unsigned char* src, uint32_t len,
+                        unsigned char* dst, uint32_t dst_len)
+{
+  uint32_t i = 0, o = 0;
+
+  while (i < len) {
+    unsigned c = src[i++];
+    if (c < 128) {
+      uint32_t n = c + 1;
+      if ((i + n > len) || (o + n > dst_len))
+        return false;
+      memcpy(dst + o, src + i, n);
+      i += n;
+      o += n;
+    }
+    else if (c > 128) {
+      uint32_t n = 257 - c;
+      if ((i >= len) || (o + n > dst_len))
+        return false;
+      memset(dst + o, src[i++], n);
+      o += n;
+    }
+  }
+  return (o == dst_len);
+}
+
+static bool is_zero(const unsigned char* p, uint32_t len)
+{
+  for (uint32_t i = 0; i < len; i++)
+    if (p[i])
+      return false;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Writer
+
+ac_checkpoint_writer::ac_checkpoint_writer(const char* file) :
+  path(file),
+  tmp_path(std::string(file) + ".tmp"),
+  page_size(sysconf(_SC_PAGE_SIZE)),
+  closed(false) {
+
+  out.open(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out) {
+    CKPT_ERROR("cannot create " << tmp_path);
+    return;
+  }
+
+  unsigned char header[16];
+  uint16_t version = AC_CHECKPOINT_VERSION;
+  memset(header, 0, sizeof(header));
+  memcpy(header, AC_CHECKPOINT_MAGIC, 6);
+  memcpy(header + 6, &version, 2);
+  memcpy(header + 8, &page_size, 4);
+  out.write((const char*) header, sizeof(header));
+}
+
+ac_checkpoint_writer::~ac_checkpoint_writer() {
+  if (!closed) {
+    out.close();
+    unlink(tmp_path.c_str());
+  }
+}
+
+void ac_checkpoint_writer::section(uint32_t kind, const char* name, uint64_t length) {
+  uint32_t name_length = strlen(name);
+
+  out.write((const char*) &kind, 4);
+  out.write((const char*) &name_length, 4);
+  out.write((const char*) &length, 8);
+  out.write(name, name_length);
+}
+
+void ac_checkpoint_writer::save(const char* name, const void* data, uint32_t size) {
+  section(AC_CKPT_VALUE, name, size);
+  out.write((const char*) data, size);
+}
+
+void ac_checkpoint_writer::save_memory(const char* name, const unsigned char* data,
+                                       uint32_t size) {
+  std::vector<ac_checkpoint_page> table;
+  std::vector<unsigned char> packed;
+  uint32_t pages = (size + page_size - 1) / page_size;
+  uint32_t raw_pages = 0;
+
+  // Classifies the pages: zero (skipped), packed or raw
+  for (uint32_t p = 0; p < pages; p++) {
+    const unsigned char* src = data + (uint64_t) p * page_size;
+    uint32_t len = (p == pages - 1) ? size - p * page_size : page_size;
+    ac_checkpoint_page e;
+
+    if (is_zero(src, len))
+      continue;
+
+    size_t before = packed.size();
+    pack_bits(src, len, packed);
+
+    e.page = p;
+    e.reserved = 0;
+    if (packed.size() - before <= len / 2) {
+      e.encoding = 1;
+      e.length = packed.size() - before;
+      e.offset = before;
+    }
+    else {
+      packed.resize(before);
+      e.encoding = 0;
+      e.length = len;
+      e.offset = raw_pages++;
+    }
+    table.push_back(e);
+  }
+
+  // Lays out the payload: table, packed data, then page aligned raw pages
+  uint64_t payload = (uint64_t) out.tellp() + 16 + strlen(name);
+  uint64_t packed_start = payload + 8 + table.size() * sizeof(ac_checkpoint_page);
+  uint64_t raw_start = packed_start + packed.size();
+  raw_start = (raw_start + page_size - 1) / page_size * page_size;
+  uint64_t end = raw_start + (uint64_t) raw_pages * page_size;
+
+  for (size_t i = 0; i < table.size(); i++) {
+    if (table[i].encoding)
+      table[i].offset += packed_start;
+    else
+      table[i].offset = raw_start + table[i].offset * page_size;
+  }
+
+  uint32_t count = table.size();
+  section(AC_CKPT_MEMORY, name, end - payload);
+  out.write((const char*) &size, 4);
+  out.write((const char*) &count, 4);
+  if (count)
+    out.write((const char*) &table[0], count * sizeof(ac_checkpoint_page));
+  if (!packed.empty())
+    out.write((const char*) &packed[0], packed.size());
+
+  std::vector<char> zeros(page_size, 0);
+  out.write(&zeros[0], raw_start - (packed_start + packed.size()));
+  for (size_t i = 0; i < table.size(); i++) {
+    if (table[i].encoding)
+      continue;
+    out.write((const char*) data + (uint64_t) table[i].page * page_size, table[i].length);
+    out.write(&zeros[0], page_size - table[i].length);
+  }
+}
+
+void ac_checkpoint_writer::save_files() {
+  std::string buf;
+  open_files_lock guard;
+
+  for (std::map<int, ac_open_file>::iterator i = open_files.begin();
+       i != open_files.end(); i++) {
+    int32_t fd = i->first;
+    int32_t flags = i->second.flags;
+    int64_t offset;
+    uint32_t length = i->second.path.size();
+
+    if (fcntl(fd, F_GETFD) == -1)
+      continue;
+    offset = lseek(fd, 0, SEEK_CUR);
+
+    buf.append((const char*) &fd, 4);
+    buf.append((const char*) &flags, 4);
+    buf.append((const char*) &offset, 8);
+    buf.append((const char*) &length, 4);
+    buf.append(i->second.path);
+  }
+
+  section(AC_CKPT_FILES, "files", buf.size());
+  out.write(buf.data(), buf.size());
+}
+
+bool ac_checkpoint_writer::close() {
+  if (closed)
+    return false;
+
+  section(AC_CKPT_END, "", 0);
+  out.close();
+  closed = true;
+
+  if (out.fail() || (rename(tmp_path.c_str(), path.c_str()) != 0)) {
+    CKPT_ERROR("cannot write " << path);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Reader
+
+ac_checkpoint_reader::ac_checkpoint_reader(const char* file) :
+  path(file),
+  fd(-1),
+  base(NULL),
+  file_size(0),
+  page_size(0) {
+
+  struct stat st;
+  const unsigned char* p;
+  uint16_t version;
+
+  if (((fd = open(file, O_RDONLY)) == -1) || (fstat(fd, &st) == -1)) {
+    CKPT_ERROR("cannot open " << path);
+    return;
+  }
+
+  file_size = st.st_size;
+  if (file_size < 16) {
+    CKPT_ERROR(path << " is not a checkpoint");
+    return;
+  }
+
+  void* m = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (m == MAP_FAILED) {
+    CKPT_ERROR("cannot map " << path);
+    return;
+  }
+  p = (const unsigned char*) m;
+
+  memcpy(&version, p + 6, 2);
+  memcpy(&page_size, p + 8, 4);
+  if (memcmp(p, AC_CHECKPOINT_MAGIC, 6) || (version != AC_CHECKPOINT_VERSION) ||
+      (page_size == 0)) {
+    CKPT_ERROR(path << " is not a version " << AC_CHECKPOINT_VERSION << " checkpoint");
+    munmap(m, file_size);
+    return;
+  }
+
+  // Indexes the sections
+  uint64_t pos = 16;
+  for (;;) {
+    uint32_t kind, name_length;
+    uint64_t length;
+
+    if (pos + 16 > file_size)
+      break;
+    memcpy(&kind, p + pos, 4);
+    memcpy(&name_length, p + pos + 4, 4);
+    memcpy(&length, p + pos + 8, 8);
+    pos += 16;
+    if (kind == AC_CKPT_END) {
+      base = p;
+      return;
+    }
+    if ((name_length > file_size - pos) || (length > file_size - pos - name_length))
+      break;
+
+    entry& e = sections[std::string((const char*) p + pos, name_length)];
+    e.kind = kind;
+    e.offset = pos + name_length;
+    e.length = length;
+    pos = e.offset + length;
+  }
+
+  CKPT_ERROR(path << " is truncated");
+  munmap(m, file_size);
+}
+
+ac_checkpoint_reader::~ac_checkpoint_reader() {
+  if (base)
+    munmap((void*) base, file_size);
+  if (fd != -1)
+    close(fd);
+}
+
+const ac_checkpoint_reader::entry* ac_checkpoint_reader::find(const char* name,
+                                                              uint32_t kind) {
+  std::map<std::string, entry>::iterator i = sections.find(name);
+
+  if ((i == sections.end()) || (i->second.kind != kind)) {
+    CKPT_ERROR(path << " has no " << name);
+    return NULL;
+  }
+  return &i->second;
+}
+
+bool ac_checkpoint_reader::restore(const char* name, void* data, uint32_t size) {
+  const entry* e = find(name, AC_CKPT_VALUE);
+
+  if (!e)
+    return false;
+  if (e->length != size) {
+    CKPT_ERROR(name << " was saved with " << e->length << " bytes, not " << size);
+    return false;
+  }
+  memcpy(data, base + e->offset, size);
+  return true;
+}
+
+bool ac_checkpoint_reader::restore_data(const char* name, std::string& data) {
+  const entry* e = find(name, AC_CKPT_VALUE);
+
+  if (!e)
+    return false;
+  data.assign((const char*) base + e->offset, e->length);
+  return true;
+}
+
+bool ac_checkpoint_reader::restore_memory(const char* name, unsigned char* data,
+                                          uint32_t size) {
+  const entry* e = find(name, AC_CKPT_MEMORY);
+  const unsigned char* p;
+  uint32_t saved_size, count;
+
+  if (!e)
+    return false;
+  p = base + e->offset;
+
+  if (e->length < 8)
+    goto corrupt;
+  memcpy(&saved_size, p, 4);
+  memcpy(&count, p + 4, 4);
+  if (saved_size != size) {
+    CKPT_ERROR(name << " was saved with " << saved_size << " bytes, not " << size);
+    return false;
+  }
+  if ((uint64_t) count * sizeof(ac_checkpoint_page) > e->length - 8)
+    goto corrupt;
+
+  {
+    // Whole pages get fresh zero pages and file mappings; the rest is copied
+    bool map = (page_size == (uint32_t) sysconf(_SC_PAGE_SIZE)) &&
+               (((uintptr_t) data % page_size) == 0);
+    uint32_t whole = map ? size / page_size * page_size : 0;
+    unsigned mappings = 0;
+
+    if (whole && (mmap(data, whole, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED))
+      whole = 0;
+    memset(data + whole, 0, size - whole);
+
+    for (uint32_t i = 0; i < count; i++) {
+      ac_checkpoint_page pg;
+      memcpy(&pg, p + 8 + i * sizeof(pg), sizeof(pg));
+
+      uint64_t start = (uint64_t) pg.page * page_size;
+      if ((start + pg.length > size) || (pg.length > page_size) ||
+          (pg.offset > file_size) || (pg.length > file_size - pg.offset))
+        goto corrupt;
+      unsigned char* dst = data + start;
+
+      if (pg.encoding == 1) {
+        uint32_t len = (size - start < page_size) ? size - start : page_size;
+        if (!unpack_bits(base + pg.offset, pg.length, dst, len))
+          goto corrupt;
+        continue;
+      }
+
+      if ((start + page_size <= whole) && (pg.offset % page_size == 0) &&
+          (mappings < max_mappings)) {
+        // Maps the run of raw pages stored one after the other
+        uint32_t run = 1;
+        while (i + run < count) {
+          ac_checkpoint_page next;
+          memcpy(&next, p + 8 + (i + run) * sizeof(next), sizeof(next));
+          if ((next.encoding != 0) || (next.page != pg.page + run) ||
+              (next.offset != pg.offset + (uint64_t) run * page_size) ||
+              ((uint64_t) next.page * page_size + page_size > whole) ||
+              (next.offset + page_size > file_size))
+            break;
+          run++;
+        }
+
+        if (mmap(dst, (size_t) run * page_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd, pg.offset) != MAP_FAILED) {
+          mappings++;
+          i += run - 1;
+          continue;
+        }
+      }
+
+      memcpy(dst, base + pg.offset, pg.length);
+    }
+  }
+  return true;
+
+ corrupt:
+  CKPT_ERROR(path << ": " << name << " is corrupt");
+  return false;
+}
+
+bool ac_checkpoint_reader::restore_files() {
+  const entry* e = find("files", AC_CKPT_FILES);
+  uint64_t pos;
+  bool ok = true;
+
+  if (!e)
+    return false;
+
+  // Releases the checkpoint descriptor, which may be one of the program's
+  if (fd != -1) {
+    close(fd);
+    fd = -1;
+  }
+
+  for (pos = 0; pos + 20 <= e->length; ) {
+    const unsigned char* p = base + e->offset + pos;
+    int32_t saved_fd, flags;
+    int64_t offset;
+    uint32_t length;
+
+    memcpy(&saved_fd, p, 4);
+    memcpy(&flags, p + 4, 4);
+    memcpy(&offset, p + 8, 8);
+    memcpy(&length, p + 16, 4);
+    if (length > e->length - pos - 20)
+      break;
+    std::string file((const char*) p + 20, length);
+    pos += 20 + length;
+
+    bool known;
+    {
+      open_files_lock guard;
+      known = open_files.find(saved_fd) != open_files.end();
+    }
+    if (!known && (fcntl(saved_fd, F_GETFD) != -1)) {
+      CKPT_ERROR("descriptor " << saved_fd << " of " << file << " is in use by the simulator");
+      ok = false;
+      continue;
+    }
+
+    int f = open(file.c_str(), flags);
+    if (f == -1) {
+      CKPT_ERROR("cannot reopen " << file);
+      ok = false;
+      continue;
+    }
+    if (f != saved_fd) {
+      if (dup2(f, saved_fd) == -1) {
+        CKPT_ERROR("cannot reopen " << file << " at descriptor " << saved_fd);
+        close(f);
+        ok = false;
+        continue;
+      }
+      close(f);
+    }
+    if (offset >= 0)
+      lseek(saved_fd, offset, SEEK_SET);
+    ac_checkpoint_open_fd(saved_fd, file.c_str(), flags);
+  }
+
+  return ok;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file      ac_chunk_writer.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Buffered output written by a background thread.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "ac_chunk_writer.H"
+
+#include <iostream>
+
+ac_chunk_writer::ac_chunk_writer(std::ostream& o, unsigned max,
+                                 const char* name) :
+  out(o), max_record(max)
+{
+  for (unsigned i = 0; i < chunk_count; i++)
+    chunks[i] = new unsigned char[chunk_size];
+  head = tail = full = 0;
+  pos = chunks[0];
+  limit = pos + chunk_size - max_record;
+  stopping = false;
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  threaded = true;
+  if (pthread_create(&writer, NULL, writer_entry, this) != 0) {
+    threaded = false;
+    std::cerr << "ArchC Warning: no " << name << " writer thread, writing synchronously\n";
+  }
+}
+
+ac_chunk_writer::~ac_chunk_writer()
+{
+  submit_chunk();
+  if (threaded) {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(writer, NULL);
+  }
+  else
+    write_chunks();
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+  for (unsigned i = 0; i < chunk_count; i++)
+    delete[] chunks[i];
+  out.flush();
+}
+
+// Hands the chunk being filled to the writer.
+void ac_chunk_writer::submit_chunk()
+{
+  pthread_mutex_lock(&mutex);
+  chunk_used[head] = pos - chunks[head];
+  head = (head + 1) % chunk_count;
+  full++;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+// Submits the current chunk and waits for a free one.
+void ac_chunk_writer::next_chunk()
+{
+  submit_chunk();
+
+  if (!threaded)
+    write_chunks();
+
+  pthread_mutex_lock(&mutex);
+  while (full == chunk_count)
+    pthread_cond_wait(&cond, &mutex);
+  pthread_mutex_unlock(&mutex);
+
+  pos = chunks[head];
+  limit = pos + chunk_size - max_record;
+}
+
+void* ac_chunk_writer::writer_entry(void* self)
+{
+  static_cast<ac_chunk_writer*>(self)->write_chunks();
+  return NULL;
+}
+
+// Writes full chunks until none is left; in threaded mode, until stopped.
+void ac_chunk_writer::write_chunks()
+{
+  pthread_mutex_lock(&mutex);
+  for (;;) {
+    while (threaded && (full == 0) && !stopping)
+      pthread_cond_wait(&cond, &mutex);
+    if (full == 0)
+      break;
+
+    unsigned c = tail;
+    pthread_mutex_unlock(&mutex);
+    out.write((const char*) chunks[c], chunk_used[c]);
+    pthread_mutex_lock(&mutex);
+
+    tail = (tail + 1) % chunk_count;
+    full--;
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&mutex);
+}
@@ -2,38 +2,136 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
-#include <tuple>
 #include <map>
 #include <algorithm>
 #include <vector>
 #include <utility>
 #include <string.h>
-#include <string>
 #include <iostream>
 #include "ac_hltrace.H"
-#include <hashtable.h>
 #include <sstream>
 #include <cassert>
 
 static char *debuginfo_path;
 
-static  Dwfl_Callbacks offline_callbacks; 
+static  Dwfl_Callbacks offline_callbacks;
+
+// Line table of the application, decoded up front: ranges sorted by start
+// address, each one mapping [start, next start) to a source line. Gaps
+// between line sequences have line -1.
+struct line_range {
+  Dwarf_Addr start;
+  int line;
+  int file;   // index in source_file_names_cache
 
-static std::map<Dwarf_Addr,std::tuple<int,int,int> > address_2_line_info_cache; //1st = lineNum, 2nd = colNum, 3rd = source_file_name_index */
+  bool operator < (const line_range& r) const { return start < r.start; }
+};
+
+static std::vector<line_range> line_ranges;
 static std::vector<std::string> source_file_names_cache;
 
+// Flat lookup table: slot (addr - table_low) >> table_shift holds the index
+// + 1 of the range of addr, 0 for none. Left empty when the code is too
+// sparse, lookups then search line_ranges.
+static std::vector<unsigned> line_table;
+static Dwarf_Addr table_low = 0;
+static Dwarf_Addr table_high = 0;
+static unsigned table_shift = 0;
+static const Dwarf_Addr max_table_slots = 1 << 26;
 
 static std::string hltrace_file_name;
 static FILE* hltrace_file = NULL;
+static bool lines_processed = false;
+
+static void put_number(unsigned long long v)
+{
+  while (v >= 0x80) {
+    putc_unlocked((int) (v & 0x7f) | 0x80, hltrace_file);
+    v >>= 7;
+  }
+  putc_unlocked((int) v, hltrace_file);
+}
 
+struct line_row {
+  Dwarf_Addr addr;
+  int line;
+  int file;
+  bool end_sequence;
 
-static Dwfl *dwfl = NULL;
+  bool operator < (const line_row& r) const { return addr < r.addr; }
+};
+
+static void build_line_table(std::vector<line_row>& rows)
+{
+  // Rows at the same address: the last one holds, end of sequence rows
+  // open a gap
+  std::stable_sort(rows.begin(), rows.end());
+  for (size_t i = 0; i < rows.size(); i++) {
+    if ((i + 1 < rows.size()) && (rows[i + 1].addr == rows[i].addr))
+      continue;
+
+    line_range r;
+    r.start = rows[i].addr;
+    r.line = rows[i].end_sequence ? -1 : rows[i].line;
+    r.file = rows[i].end_sequence ? -1 : rows[i].file;
+    if (!line_ranges.empty() && (line_ranges.back().line == r.line) &&
+        (line_ranges.back().file == r.file))
+      continue;
+    line_ranges.push_back(r);
+  }
+
+  if (line_ranges.empty())
+    return;
+
+  // Slots as wide as the coarsest alignment of the range starts, so that
+  // no slot spans two ranges
+  Dwarf_Addr bits = 0;
+  table_low = line_ranges.front().start;
+  table_high = line_ranges.back().start;
+  for (size_t i = 0; i < line_ranges.size(); i++)
+    bits |= line_ranges[i].start - table_low;
+  for (table_shift = 0; bits && !(bits & 1); bits >>= 1)
+    table_shift++;
+
+  if (((table_high - table_low) >> table_shift) > max_table_slots)
+    return;
+
+  line_table.assign((table_high - table_low) >> table_shift, 0);
+  for (size_t i = 0; i + 1 < line_ranges.size(); i++) {
+    if (line_ranges[i].line == -1)
+      continue;
+    for (Dwarf_Addr s = (line_ranges[i].start - table_low) >> table_shift;
+         s < ((line_ranges[i + 1].start - table_low) >> table_shift); s++)
+      line_table[s] = i + 1;
+  }
+}
+
+static inline const line_range* find_line(Dwarf_Addr addr)
+{
+  if (!line_table.empty()) {
+    if ((addr < table_low) || (addr >= table_high))
+      return NULL;
+    unsigned index = line_table[(addr - table_low) >> table_shift];
+    return index ? &line_ranges[index - 1] : NULL;
+  }
+
+  line_range key;
+  key.start = addr;
+  std::vector<line_range>::const_iterator it =
+    std::upper_bound(line_ranges.begin(), line_ranges.end(), key);
+  if (it == line_ranges.begin())
+    return NULL;
+  --it;
+  return (it->line != -1) ? &*it : NULL;
+}
 
 void pre_process_lines_info()
 {
   extern char* appfilename;
   extern const char *project_name;
 
+  lines_processed = true;
+
   if (hltrace_file_name.empty())
   {
     std::string appNameString (appfilename);
@@ -43,7 +141,10 @@ void pre_process_lines_info()
 
   if(hltrace_file == NULL)
   {
-    hltrace_file  = fopen(hltrace_file_name.c_str(),"w+");
+    hltrace_file  = fopen(hltrace_file_name.c_str(),"w");
+    if (hltrace_file == NULL)
+      return;
+    setvbuf(hltrace_file, NULL, _IOFBF, 1 << 20);
   }
 
   offline_callbacks.find_debuginfo = dwfl_standard_find_debuginfo;
@@ -51,16 +152,14 @@ void pre_process_lines_info()
   offline_callbacks.section_address = dwfl_offline_section_address;
   offline_callbacks.find_elf = dwfl_build_id_find_elf;
 
-  if(dwfl == NULL)
-  {
-    dwfl = dwfl_begin (&offline_callbacks);
-    dwfl_report_offline (dwfl, "", appfilename, -1); 
-  }
-  
+  Dwfl *dwfl = dwfl_begin (&offline_callbacks);
+  dwfl_report_offline (dwfl, "", appfilename, -1);
 
+  std::map<std::string, int> source_file_indexes;
+  std::vector<line_row> rows;
   Dwarf_Addr bias = 0;
   Dwarf_Die *lastcu = NULL;
-  do 
+  do
   {
     lastcu = dwfl_nextcu (dwfl, lastcu, &bias);
 
@@ -68,32 +167,31 @@ void pre_process_lines_info()
     {
       size_t numb_lines = 0;
       dwfl_getsrclines (lastcu, &numb_lines);
-      for (int r = 0; r < numb_lines; ++r)
+      for (size_t r = 0; r < numb_lines; ++r)
       {
         Dwfl_Line* myline =  dwfl_onesrcline (lastcu, r);
 
-        
-
-        int linep;
+        line_row row;
         int colp;
         Dwarf_Word mtime;
         Dwarf_Word length;
-        Dwarf_Addr curaddr;
-        const char * current_source_file_name =  dwfl_lineinfo (myline, &curaddr, &linep, &colp, &mtime, &length);
-        std::vector<std::string>::iterator sourceIt = std::find(source_file_names_cache.begin(),source_file_names_cache.end(),std::string(current_source_file_name));
-        int source_file_names_cache_index;
-        if(sourceIt != source_file_names_cache.end())
-        {
-          source_file_names_cache_index = sourceIt - source_file_names_cache.begin();
-        }
-        else
+        Dwarf_Addr line_bias;
+        bool end_sequence = false;
+        const char * current_source_file_name =  dwfl_lineinfo (myline, &row.addr, &row.line, &colp, &mtime, &length);
+        if (current_source_file_name == NULL)
+          continue;
+        dwarf_lineendsequence (dwfl_dwarf_line (myline, &line_bias), &end_sequence);
+
+        std::map<std::string, int>::iterator sourceIt = source_file_indexes.find(current_source_file_name);
+        if (sourceIt == source_file_indexes.end())
         {
-          source_file_names_cache_index = source_file_names_cache.size();
-          source_file_names_cache.push_back(std::string(current_source_file_name));
+          sourceIt = source_file_indexes.insert(std::make_pair(std::string(current_source_file_name), (int) source_file_names_cache.size())).first;
+          source_file_names_cache.push_back(current_source_file_name);
         }
 
-        address_2_line_info_cache[curaddr] = std::tuple<int,int,int>(linep,colp,source_file_names_cache_index);
-
+        row.file = sourceIt->second;
+        row.end_sequence = end_sequence;
+        rows.push_back(row);
       }
 
     }
@@ -101,87 +199,42 @@ void pre_process_lines_info()
 
   } while(lastcu != NULL);
 
-  for (int i = 0; i < source_file_names_cache.size(); ++i)
+  // Everything needed is in the line table now
+  dwfl_end (dwfl);
+  build_line_table(rows);
+
+  fwrite(AC_HLTRACE_MAGIC, 1, 8, hltrace_file);
+  put_number(source_file_names_cache.size());
+  for (size_t i = 0; i < source_file_names_cache.size(); ++i)
   {
-    fprintf(hltrace_file, "%s\n", source_file_names_cache[i].c_str() );
-    
+    fwrite(source_file_names_cache[i].c_str(), 1, source_file_names_cache[i].size() + 1, hltrace_file);
   }
-  fprintf(hltrace_file, "---\n" );
 
 }
 
 
 void generate_trace_for_address(unsigned long long int addr)
 {
-
-
-  if(address_2_line_info_cache.empty())
-  {
-    pre_process_lines_info();
-
-  }
   static int last_trace_line = -1;
   static int last_trace_file_index = -1;
 
-  if(hltrace_file)
-  {
-    
-    int new_trace_line;
-    int new_trace_file_index;
-
-
-
-    std::map<Dwarf_Addr,std::tuple<int,int,int> >::iterator it_num = address_2_line_info_cache.find(addr);
-    if(it_num != address_2_line_info_cache.end())
-    {
-      std::tuple<int,int,int> line_info = it_num->second;
-      new_trace_line = std::get<0>(line_info);
-      new_trace_file_index = std::get<2>(line_info);
-    }
-    else
-    {
-      Dwfl_Line* myline = dwfl_getsrc(dwfl,addr);
-      if(myline == NULL)
-        return;
-      int linep;
-      int colp;
-      Dwarf_Word mtime;
-      Dwarf_Word length;
-      Dwarf_Addr curaddr;
-      const char * current_source_file_name =  dwfl_lineinfo (myline, &curaddr, &linep, &colp, &mtime, &length);
-      if(current_source_file_name == NULL)
-        return;
-      std::vector<std::string>::iterator sourceIt = std::find(source_file_names_cache.begin(),source_file_names_cache.end(),std::string(current_source_file_name));
-      int source_file_names_cache_index;
-      if(sourceIt != source_file_names_cache.end())
-      {
-        source_file_names_cache_index = sourceIt - source_file_names_cache.begin();
-      }
-      else
-      {
-        source_file_names_cache_index = source_file_names_cache.size();
-        source_file_names_cache.push_back(std::string(current_source_file_name));
-      }
-
-      address_2_line_info_cache[curaddr] = std::tuple<int,int,int>(linep,colp,source_file_names_cache_index);
-      new_trace_line = linep;
-      new_trace_file_index = source_file_names_cache_index;
-    }
+  if (!lines_processed)
+    pre_process_lines_info();
 
+  if (hltrace_file == NULL)
+    return;
 
+  const line_range* r = find_line(addr);
+  if ((r == NULL) ||
+      ((r->line == last_trace_line) && (r->file == last_trace_file_index)))
+    return;
 
-    if((new_trace_line != last_trace_line || new_trace_file_index != last_trace_file_index) && new_trace_line != -1 && new_trace_file_index != -1)
-    {
-      if(new_trace_file_index != last_trace_file_index)
-      {
-        last_trace_file_index = new_trace_file_index;
-        fprintf(hltrace_file, "f_%d\n",new_trace_file_index);
-      }
-      last_trace_line = new_trace_line;
-      fprintf(hltrace_file, "%d\n", new_trace_line);
-    }
+  bool file_changed = (r->file != last_trace_file_index);
+  put_number(((unsigned long long) r->line << 1) | file_changed);
+  if (file_changed)
+  {
+    put_number(r->file);
+    last_trace_file_index = r->file;
   }
-
+  last_trace_line = r->line;
 }
-
-
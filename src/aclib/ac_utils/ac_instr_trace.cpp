@@ -0,0 +1,109 @@
+/**
+ * @file      ac_instr_trace.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Binary instruction trace writer and reader.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "ac_instr_trace.H"
+
+#include <stdio.h>
+#include <string.h>
+
+ac_instr_trace* ac_bin_trace = NULL;
+
+// The writer thread only touches out once a chunk is submitted, so the
+// header can be written after it starts.
+ac_instr_trace::ac_instr_trace(std::ostream& o,
+                               const std::vector<std::string>& names) :
+  out(o), last_pc(0), last_address(0),
+  writer(o, max_record, "instruction trace")
+{
+  unsigned char number[10];
+
+  out.write(AC_INSTR_TRACE_MAGIC, 8);
+  out.write((const char*) number, put_number(number, names.size()) - number);
+  for (unsigned i = 0; i < names.size(); i++)
+    out.write(names[i].c_str(), names[i].size() + 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_instr_trace_reader::ac_instr_trace_reader(std::istream& i) :
+  in(i.rdbuf()), last_pc(0), last_address(0), valid(false)
+{
+  char magic[8];
+  unsigned long long count;
+
+  if ((in->sgetn(magic, 8) != 8) || memcmp(magic, AC_INSTR_TRACE_MAGIC, 8) ||
+      !get_number(count))
+    return;
+
+  names.resize(count);
+  for (unsigned long long n = 0; n < count; n++) {
+    int c;
+    while ((c = in->sbumpc()) > 0)
+      names[n] += (char) c;
+    if (c == EOF)
+      return;
+  }
+  valid = true;
+}
+
+bool ac_instr_trace_reader::get_number(unsigned long long& v)
+{
+  int c;
+  unsigned shift = 0;
+
+  v = 0;
+  do {
+    if (((c = in->sbumpc()) == EOF) || (shift > 63))
+      return false;
+    v |= (unsigned long long) (c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  return true;
+}
+
+bool ac_instr_trace_reader::next(ac_instr_trace_record& r)
+{
+  unsigned long long head, delta;
+
+  if (!valid || !get_number(head) || !get_number(delta))
+    return false;
+
+  unsigned d = ((unsigned) delta >> 1) ^ -((unsigned) delta & 1);
+  r.kind = (ac_instr_trace_kind) (head & 3);
+  switch (r.kind) {
+    case AC_ITRACE_INSTR:
+      r.id = head >> 2;
+      r.pc = last_pc += d;
+      return true;
+
+    case AC_ITRACE_READ:
+    case AC_ITRACE_WRITE:
+      r.size = head >> 2;
+      r.address = last_address += d;
+      return get_number(r.value);
+
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,319 @@
+/**
+ * @file      ac_profiler.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Basic block profiler.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "ac_profiler.H"
+#include "ac_utils.H"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+namespace {
+
+  const unsigned hot_blocks = 20;
+  const unsigned hot_functions = 10;
+  const unsigned mix_entries = 6;
+
+  struct symbol {
+    unsigned address;
+    unsigned size;
+    std::string name;
+
+    // Sized symbols after the labels at the same address, so lookups
+    // prefer them
+    bool operator < (const symbol& s) const {
+      return (address < s.address) || ((address == s.address) && (size < s.size));
+    }
+  };
+
+  // Reads the function symbols of an ELF file, sorted by address.
+  void read_symbols(const char* file, bool match_endian,
+                    std::vector<symbol>& symbols)
+  {
+    Elf32_Ehdr ehdr;
+    Elf32_Shdr shdr, strhdr;
+    int fd;
+
+    if (!file || ((fd = open(file, O_RDONLY)) == -1))
+      return;
+
+    if ((read(fd, &ehdr, sizeof(ehdr)) != sizeof(ehdr)) ||
+        (strncmp((char *) ehdr.e_ident, ELFMAG, 4) != 0)) {
+      close(fd);
+      return;
+    }
+
+    unsigned shoff = convert_endian(4, ehdr.e_shoff, match_endian);
+    unsigned shentsize = convert_endian(2, ehdr.e_shentsize, match_endian);
+    unsigned shnum = convert_endian(2, ehdr.e_shnum, match_endian);
+
+    for (unsigned i = 0; i < shnum; i++) {
+      if ((pread(fd, &shdr, sizeof(shdr), shoff + i * shentsize) != sizeof(shdr)) ||
+          (convert_endian(4, shdr.sh_type, match_endian) != SHT_SYMTAB))
+        continue;
+
+      unsigned link = convert_endian(4, shdr.sh_link, match_endian);
+      if (pread(fd, &strhdr, sizeof(strhdr), shoff + link * shentsize) != sizeof(strhdr))
+        break;
+
+      std::vector<char> strings(convert_endian(4, strhdr.sh_size, match_endian) + 1);
+      std::vector<Elf32_Sym> syms(convert_endian(4, shdr.sh_size, match_endian) / sizeof(Elf32_Sym));
+      if ((pread(fd, &strings[0], strings.size() - 1,
+                 convert_endian(4, strhdr.sh_offset, match_endian)) != (ssize_t) strings.size() - 1) ||
+          (pread(fd, &syms[0], syms.size() * sizeof(Elf32_Sym),
+                 convert_endian(4, shdr.sh_offset, match_endian)) != (ssize_t) (syms.size() * sizeof(Elf32_Sym))))
+        break;
+
+      for (unsigned j = 0; j < syms.size(); j++) {
+        unsigned name = convert_endian(4, syms[j].st_name, match_endian);
+        if ((ELF32_ST_TYPE(syms[j].st_info) != STT_FUNC) || (name >= strings.size() - 1))
+          continue;
+
+        symbol s;
+        s.address = convert_endian(4, syms[j].st_value, match_endian);
+        s.size = convert_endian(4, syms[j].st_size, match_endian);
+        s.name = &strings[name];
+        symbols.push_back(s);
+      }
+      break;
+    }
+
+    close(fd);
+    std::sort(symbols.begin(), symbols.end());
+  }
+
+  // Returns the function holding pc, or NULL.
+  const symbol* find_symbol(const std::vector<symbol>& symbols, unsigned pc)
+  {
+    symbol key;
+    key.address = pc;
+    key.size = ~0U;
+
+    std::vector<symbol>::const_iterator it =
+      std::upper_bound(symbols.begin(), symbols.end(), key);
+    if (it == symbols.begin())
+      return NULL;
+    --it;
+    if ((it->size != 0) && (pc - it->address >= it->size))
+      return NULL;
+    return &*it;
+  }
+
+  std::string location(const symbol* s, unsigned pc)
+  {
+    char offset[16];
+
+    if (!s)
+      return "??";
+    if (pc == s->address)
+      return s->name;
+    snprintf(offset, sizeof(offset), "+%#x", pc - s->address);
+    return s->name + offset;
+  }
+
+  struct function {
+    const symbol* sym;
+    unsigned long long instructions;
+    std::vector<unsigned> blocks;
+  };
+
+  bool more_instructions(const function& a, const function& b)
+  {
+    return a.instructions > b.instructions;
+  }
+
+  bool more_count(const std::pair<unsigned, unsigned long long>& a,
+                  const std::pair<unsigned, unsigned long long>& b)
+  {
+    return a.second > b.second;
+  }
+
+  double percent(unsigned long long part, unsigned long long total)
+  {
+    return total ? (100.0 * part) / total : 0.0;
+  }
+
+}
+
+ac_profiler::ac_profiler() :
+  current(0), block_start(0), interval(0), interval_end(~0ULL)
+{
+}
+
+ac_profiler::~ac_profiler()
+{
+  for (unsigned i = 0; i < pages.size(); i++)
+    delete[] pages[i];
+}
+
+bool ac_profiler::open_bbv(const char* file, unsigned long long n)
+{
+  bbv.open(file);
+  if (!bbv || (n == 0)) {
+    AC_ERROR("cannot write basic block vectors to " << file);
+    return false;
+  }
+  interval = n;
+  interval_end = n;
+  return true;
+}
+
+unsigned ac_profiler::lookup(unsigned pc)
+{
+  unsigned page = pc >> page_bits;
+
+  if (page >= pages.size())
+    pages.resize(page + 1, NULL);
+  if (!pages[page])
+    pages[page] = new unsigned[1U << page_bits]();
+
+  unsigned& index = pages[page][pc & ((1U << page_bits) - 1)];
+  if (!index) {
+    block b;
+    b.pc = pc;
+    b.executions = b.instructions = b.interval_instructions = 0;
+    blocks.push_back(b);
+    index = blocks.size();
+  }
+  return index;
+}
+
+void ac_profiler::end_interval(unsigned long long count)
+{
+  bbv << 'T';
+  for (unsigned i = 0; i < touched.size(); i++) {
+    block& b = blocks[touched[i]];
+    bbv << ':' << touched[i] + 1 << ':' << b.interval_instructions << ' ';
+    b.interval_instructions = 0;
+  }
+  bbv << '\n';
+  touched.clear();
+
+  while (interval_end <= count)
+    interval_end += interval;
+}
+
+void ac_profiler::finish(unsigned long long count)
+{
+  if (current)
+    leave(count);
+  current = 0;
+  if (interval && !touched.empty())
+    end_interval(count);
+  if (bbv.is_open())
+    bbv.close();
+}
+
+void ac_profiler::report(std::ostream& os, const char* elf_file,
+                         bool match_endian, decode_fn decode, void* context,
+                         const ac_instr_info* instr_table)
+{
+  std::vector<symbol> symbols;
+  std::vector<unsigned> order;
+  std::map<const symbol*, function> by_symbol;
+  unsigned long long total = 0;
+
+  read_symbols(elf_file, match_endian, symbols);
+
+  for (unsigned i = 0; i < blocks.size(); i++) {
+    if (!blocks[i].instructions)
+      continue;
+    total += blocks[i].instructions;
+    order.push_back(i);
+
+    function& f = by_symbol[find_symbol(symbols, blocks[i].pc)];
+    f.instructions += blocks[i].instructions;
+    f.blocks.push_back(i);
+  }
+
+  // Hottest blocks first
+  std::vector<std::pair<unsigned, unsigned long long> > ranked;
+  for (unsigned i = 0; i < order.size(); i++)
+    ranked.push_back(std::make_pair(order[i], blocks[order[i]].instructions));
+  std::stable_sort(ranked.begin(), ranked.end(), more_count);
+
+  os << "ArchC: Profile: " << ranked.size() << " basic blocks, "
+     << total << " instructions" << std::endl;
+  os << "ArchC: Hot basic blocks (pc, instructions, executions x length):" << std::endl;
+  for (unsigned i = 0; (i < ranked.size()) && (i < hot_blocks); i++) {
+    const block& b = blocks[ranked[i].first];
+    char line[96];
+
+    snprintf(line, sizeof(line), "  0x%08x %16llu %6.2f%% %14llu x %-5llu ",
+             b.pc, b.instructions, percent(b.instructions, total),
+             b.executions, b.instructions / b.executions);
+    os << line << location(find_symbol(symbols, b.pc), b.pc) << std::endl;
+  }
+
+  std::vector<function> functions;
+  for (std::map<const symbol*, function>::iterator it = by_symbol.begin();
+       it != by_symbol.end(); it++) {
+    it->second.sym = it->first;
+    functions.push_back(it->second);
+  }
+  std::stable_sort(functions.begin(), functions.end(), more_instructions);
+
+  os << "ArchC: Hot functions:" << std::endl;
+  for (unsigned i = 0; (i < functions.size()) && (i < hot_functions); i++) {
+    const function& f = functions[i];
+    char line[64];
+
+    snprintf(line, sizeof(line), "  %16llu %6.2f%% %6u blocks  ",
+             f.instructions, percent(f.instructions, total),
+             (unsigned) f.blocks.size());
+    os << line << (f.sym ? f.sym->name : "??") << std::endl;
+
+    if (!decode)
+      continue;
+
+    // Instruction mix: walk each block through the decoder cache
+    std::map<unsigned, unsigned long long> mix;
+    unsigned long long mixed = 0;
+    for (unsigned j = 0; j < f.blocks.size(); j++) {
+      const block& b = blocks[f.blocks[j]];
+      unsigned long long length = b.instructions / b.executions;
+      unsigned pc = b.pc;
+      unsigned id;
+
+      for (unsigned long long k = 0; (k < length) && decode(context, pc, id); k++) {
+        mix[id] += b.executions;
+        mixed += b.executions;
+        if (!instr_table[id].ac_instr_size)
+          break;
+        pc += instr_table[id].ac_instr_size;
+      }
+    }
+
+    std::vector<std::pair<unsigned, unsigned long long> > sorted(mix.begin(), mix.end());
+    std::stable_sort(sorted.begin(), sorted.end(), more_count);
+    os << "      mix:";
+    for (unsigned j = 0; (j < sorted.size()) && (j < mix_entries); j++) {
+      char entry[32];
+      snprintf(entry, sizeof(entry), " %.1f%%", percent(sorted[j].second, mixed));
+      os << ' ' << instr_table[sorted[j].first].ac_instr_name << entry;
+    }
+    os << std::endl;
+  }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file      ac_sampling.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Sampled simulation schedule.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "ac_sampling.H"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+ac_sampler::ac_sampler() :
+  warm_up(0), length(0), measure_start(0), current(0), state(OFF)
+{
+}
+
+bool ac_sampler::load(const char* file, unsigned long long w,
+                      unsigned long long l)
+{
+  std::ifstream in(file);
+  std::string line;
+  unsigned number = 0;
+
+  if (!in) {
+    std::cerr << "ArchC ERROR: cannot open sample file " << file << '\n';
+    return false;
+  }
+
+  samples.clear();
+  while (std::getline(in, line)) {
+    sample s;
+    int fields;
+
+    number++;
+    if (line.empty() || (line[0] == '#'))
+      continue;
+
+    s.weight = 1.0;
+    fields = sscanf(line.c_str(), "%llu %lf", &s.start, &s.weight);
+    if (fields < 1) {
+      std::cerr << "ArchC Warning: " << file << ":" << number
+                << ": invalid sample ignored\n";
+      continue;
+    }
+    samples.push_back(s);
+  }
+
+  if (samples.empty() || (l == 0)) {
+    std::cerr << "ArchC ERROR: no sample to simulate in " << file << '\n';
+    return false;
+  }
+
+  std::stable_sort(samples.begin(), samples.end());
+  warm_up = w;
+  length = l;
+  current = 0;
+  state = FAST_FORWARD;
+  return true;
+}
+
+double ac_sampler::get_weight() const
+{
+  return (current < samples.size()) ? samples[current].weight : 0.0;
+}
+
+unsigned long long ac_sampler::next_change() const
+{
+  switch (state) {
+    case FAST_FORWARD:
+      return (samples[current].start > warm_up) ?
+             samples[current].start - warm_up : 0;
+    case WARM_UP:
+      return samples[current].start;
+    case MEASURE:
+      return measure_start + length;
+    default:
+      return ~0ULL;
+  }
+}
+
+ac_sampler::phase ac_sampler::advance(unsigned long long count)
+{
+  if (state == OFF)
+    return state;
+
+  if (state == MEASURE)
+    current++;
+
+  if (current == samples.size())
+    state = DONE;
+  else if ((samples[current].start > warm_up) &&
+           (count < samples[current].start - warm_up))
+    state = FAST_FORWARD;
+  else if (count < samples[current].start)
+    state = WARM_UP;
+  else {
+    state = MEASURE;
+    measure_start = count;
+  }
+  return state;
+}
@@ -35,6 +35,8 @@
  */
 
 #include "ac_utils.H"
+#include "ac_instr_info.H"
+#include "ac_module.H"
 
 #ifdef USE_GDB
 #include "ac_gdb.H"
@@ -60,6 +62,25 @@ bool ac_do_trace;
 //Name of the file containing the application to be loaded.
 //char *appfilename;
 std::map<std::string, std::ofstream*> ac_cache_traces;
+std::set<std::string> ac_cache_binary_traces;
+
+//Checkpoint options
+std::string ac_checkpoint_path;
+unsigned long long ac_checkpoint_count = ~0ULL;
+std::string ac_restore_path;
+
+//Sampled simulation options
+std::string ac_sample_path;
+unsigned long long ac_sample_warm_up = 1000000;
+unsigned long long ac_sample_length = 10000000;
+
+//Basic block profiler options
+std::string ac_profile_bbv_path;
+unsigned long long ac_profile_interval = 10000000;
+
+//Binary instruction trace option
+std::string ac_trace_bin_path;
+static std::ofstream* ac_trace_bin_file = NULL;
 
 //Read model options before application
 void ac_init_opts( int ac, char* av[]){
@@ -81,6 +102,17 @@ void ac_init_opts( int ac, char* av[]){
             cerr << "  --load=<prog_path>      Load target application\n";
             cerr << "  -- <prog_path>          Load target application\n";
             cerr << "  --trace-cache=<cache>,<file> Trace cache access\n";
+            cerr << "  --trace-cache-bin=<cache>,<file> Trace cache access in binary format\n";
+            cerr << "  --checkpoint=<file>     Save checkpoints to <file> (SIGUSR2 takes one)\n";
+            cerr << "  --checkpoint-at=<n>     Save a checkpoint after <n> instructions\n";
+            cerr << "  --restore=<file>        Start from the checkpoint saved in <file>\n";
+            cerr << "  --sample=<file>         Simulate only the samples listed in <file> (simulators built with --sampling)\n";
+            cerr << "  --sample-warmup=<n>     Warm up caches for <n> instructions per sample (default 1000000)\n";
+            cerr << "  --sample-length=<n>     Measure <n> instructions per sample (default 10000000)\n";
+            cerr << "  --profile-bbv=<file>    Write basic block vectors to <file> (simulators built with --profile)\n";
+            cerr << "  --profile-interval=<n>  Basic block vector interval in instructions (default 10000000)\n";
+            cerr << "  --trace-bin=<file>      Write the instruction trace to <file> in binary format (simulators built with -g, not with --parallel)\n";
+            cerr << "  --parallel              Run each processor on its own host thread\n";
 #ifdef USE_GDB
             //      cerr << "  --gdb[=<port>]          Enable GDB support\n";
 #endif /* USE_GDB */
@@ -101,6 +133,7 @@ args_t ac_init_args( int ac, char* av[]){
 
     int size;
     char *appname=0;
+    bool parallel = false;
     int ac_argc;
     char** ac_argv;
 
@@ -161,16 +194,25 @@ args_t ac_init_args( int ac, char* av[]){
         //     }
 #endif /* USE_GDB */
 
-        else if ( (size>14) && (!strncmp(av[1], "--trace-cache=", 14)) ) {
+        else if ( ((size>14) && (!strncmp(av[1], "--trace-cache=", 14))) ||
+                  ((size>18) && (!strncmp(av[1], "--trace-cache-bin=", 18))) ) {
+            bool binary = (av[1][13] == '-');
             char *comma = strchr(av[1], ',');
             if (comma == NULL) {
                 std::cerr << "Error: invalid argument syntax.\n";
                 exit(EXIT_FAILURE);
             }
-            std::string cache_name(av[1]+14, comma);
+            std::string cache_name(strchr(av[1], '=')+1, comma);
             std::string file_name(comma+1, av[1]+size);
-            ac_cache_traces[cache_name] = new std::ofstream(file_name.c_str());
-            if (!ac_cache_traces[cache_name]) {
+            if (binary) {
+                ac_cache_traces[cache_name] = new std::ofstream(file_name.c_str(), std::ios::out | std::ios::binary);
+                ac_cache_binary_traces.insert(cache_name);
+            }
+            else {
+                ac_cache_traces[cache_name] = new std::ofstream(file_name.c_str());
+                ac_cache_binary_traces.erase(cache_name);
+            }
+            if (!*ac_cache_traces[cache_name]) {
                 std::cerr << "Error opening file: " << file_name << "\n";
                 exit(EXIT_FAILURE);
             }
@@ -183,11 +225,124 @@ args_t ac_init_args( int ac, char* av[]){
             ac--;
             continue;
         }
+        else if ( ((size>13) && (!strncmp(av[1], "--checkpoint=", 13))) ||
+                  ((size>16) && (!strncmp(av[1], "--checkpoint-at=", 16))) ||
+                  ((size>10) && (!strncmp(av[1], "--restore=", 10))) ) {
+            const char *value = strchr(av[1], '=') + 1;
+            if (av[1][2] == 'r') {
+                ac_restore_path = value;
+            }
+            else if (av[1][12] == '-') {
+                char *end;
+                ac_checkpoint_count = strtoull(value, &end, 0);
+                if (*end != '\0') {
+                    std::cerr << "Error: invalid argument syntax.\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else {
+                ac_checkpoint_path = value;
+            }
+            // Remove this parameter from the list and reset the loop
+            for (int i = 1; i <= ac; i++) {
+                av[i] = av[i+1];
+            }
+
+            ac_argc--;
+            ac--;
+            continue;
+        }
+        else if ( (size>9) && (!strncmp(av[1], "--sample", 8)) &&
+                  ((av[1][8] == '=') || (av[1][8] == '-')) ) {
+            const char *value = strchr(av[1], '=');
+            if (value == NULL) {
+                std::cerr << "Error: invalid argument syntax.\n";
+                exit(EXIT_FAILURE);
+            }
+            value++;
+            if (av[1][8] == '=') {
+                ac_sample_path = value;
+            }
+            else {
+                char *end;
+                unsigned long long n = strtoull(value, &end, 0);
+                if ((*end != '\0') ||
+                    (strncmp(av[1], "--sample-warmup=", 16) &&
+                     strncmp(av[1], "--sample-length=", 16))) {
+                    std::cerr << "Error: invalid argument syntax.\n";
+                    exit(EXIT_FAILURE);
+                }
+                if (av[1][9] == 'w')
+                    ac_sample_warm_up = n;
+                else
+                    ac_sample_length = n;
+            }
+            // Remove this parameter from the list and reset the loop
+            for (int i = 1; i <= ac; i++) {
+                av[i] = av[i+1];
+            }
+
+            ac_argc--;
+            ac--;
+            continue;
+        }
+        else if ( (size==10) && (!strncmp(av[1], "--parallel", 10)) ) {
+            ac_module::set_parallel(true);
+            parallel = true;
+            // Remove this parameter from the list and reset the loop
+            for (int i = 1; i <= ac; i++) {
+                av[i] = av[i+1];
+            }
+
+            ac_argc--;
+            ac--;
+            continue;
+        }
+        else if ( (size>12) && (!strncmp(av[1], "--trace-bin=", 12)) ) {
+            ac_trace_bin_path = av[1] + 12;
+            // Remove this parameter from the list and reset the loop
+            for (int i = 1; i <= ac; i++) {
+                av[i] = av[i+1];
+            }
+
+            ac_argc--;
+            ac--;
+            continue;
+        }
+        else if ( ((size>14) && (!strncmp(av[1], "--profile-bbv=", 14))) ||
+                  ((size>19) && (!strncmp(av[1], "--profile-interval=", 19))) ) {
+            const char *value = strchr(av[1], '=') + 1;
+            if (av[1][10] == 'b') {
+                ac_profile_bbv_path = value;
+            }
+            else {
+                char *end;
+                ac_profile_interval = strtoull(value, &end, 0);
+                if ((*end != '\0') || (ac_profile_interval == 0)) {
+                    std::cerr << "Error: invalid argument syntax.\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            // Remove this parameter from the list and reset the loop
+            for (int i = 1; i <= ac; i++) {
+                av[i] = av[i+1];
+            }
+
+            ac_argc--;
+            ac--;
+            continue;
+        }
 
         ac --;
         av ++;
     }
 
+    // All processors would record to the same trace from their own threads
+    if (parallel && !ac_trace_bin_path.empty()) {
+        AC_ERROR("--trace-bin cannot be used with --parallel.");
+        exit(1);
+    }
+
     if (!appname) {
         AC_ERROR("No application provided.");
         AC_ERROR("Use --load=<prog_path> or -- <prog_path> to load a target application.");
@@ -203,6 +358,52 @@ args_t ac_init_args( int ac, char* av[]){
     return args;
 }
 
+// Writes the trace of the simulated program to file, in binary format,
+// instead of the text trace file
+bool ac_trace_binary(const char* file, const ac_instr_info* instr_table,
+                     unsigned count)
+{
+    std::vector<std::string> names(count);
+
+    ac_close_trace();
+    ac_trace_bin_file = new std::ofstream(file, std::ios::out | std::ios::binary);
+    if (!*ac_trace_bin_file) {
+        AC_ERROR("cannot write instruction trace to " << file);
+        delete ac_trace_bin_file;
+        ac_trace_bin_file = NULL;
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        if (instr_table[i].ac_instr_name)
+            names[i] = instr_table[i].ac_instr_name;
+    ac_bin_trace = new ac_instr_trace(*ac_trace_bin_file, names);
+    ac_do_trace = true;
+
+    // Programs often end through exit(): flush the trace then too
+    static bool registered = false;
+    if (!registered) {
+        atexit(ac_close_trace);
+        registered = true;
+    }
+    return true;
+}
+
+void ac_close_trace()
+{
+    if (ac_bin_trace) {
+        delete ac_bin_trace;
+        ac_bin_trace = NULL;
+    }
+    if (ac_trace_bin_file) {
+        ac_trace_bin_file->close();
+        delete ac_trace_bin_file;
+        ac_trace_bin_file = NULL;
+    }
+    if (trace_file.is_open())
+        trace_file.close();
+}
+
 unsigned int convert_endian(unsigned int size, unsigned int num, bool match_endian)
 {
   unsigned char *in = (unsigned char*) &num;
@@ -0,0 +1,107 @@
+/**
+ * @file      achltracedump.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Prints a binary high level trace in the former text format:
+ *            the source file names, "---", then one line number per line
+ *            change, preceded by "f_<file index>" when the file changes.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#include "ac_hltrace.H"
+
+static bool get_number(FILE* in, unsigned long long& v)
+{
+  int c;
+  unsigned shift = 0;
+
+  v = 0;
+  do {
+    if (((c = getc_unlocked(in)) == EOF) || (shift > 63))
+      return false;
+    v |= (unsigned long long) (c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if ((argc < 2) || (argc > 3)) {
+    std::cerr << "Usage: " << argv[0] << " <binary hltrace> [<text hltrace>]\n"
+              << "Prints a binary high level trace in text format.\n";
+    return EXIT_FAILURE;
+  }
+
+  FILE* in = fopen(argv[1], "rb");
+  if (!in) {
+    std::cerr << "Error opening file: " << argv[1] << "\n";
+    return EXIT_FAILURE;
+  }
+  setvbuf(in, NULL, _IOFBF, 1 << 20);
+
+  char magic[8];
+  unsigned long long files;
+  if ((fread(magic, 1, 8, in) != 8) || memcmp(magic, AC_HLTRACE_MAGIC, 8) ||
+      !get_number(in, files)) {
+    std::cerr << "Error: " << argv[1] << " is not a binary high level trace\n";
+    return EXIT_FAILURE;
+  }
+
+  FILE* out = stdout;
+  if ((argc == 3) && !(out = fopen(argv[2], "w"))) {
+    std::cerr << "Error opening file: " << argv[2] << "\n";
+    return EXIT_FAILURE;
+  }
+  setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+  for (unsigned long long i = 0; i < files; i++) {
+    int c;
+    while ((c = getc_unlocked(in)) > 0)
+      putc_unlocked(c, out);
+    if (c == EOF) {
+      std::cerr << "Error: truncated file names in " << argv[1] << "\n";
+      return EXIT_FAILURE;
+    }
+    putc_unlocked('\n', out);
+  }
+  fputs("---\n", out);
+
+  unsigned long long record, file;
+  while (get_number(in, record)) {
+    if (record & 1) {
+      if (!get_number(in, file))
+        break;
+      fprintf(out, "f_%llu\n", file);
+    }
+    fprintf(out, "%llu\n", record >> 1);
+  }
+
+  fclose(in);
+  if ((out != stdout) ? (fclose(out) != 0) : (fflush(out) != 0)) {
+    std::cerr << "Error writing the text trace\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
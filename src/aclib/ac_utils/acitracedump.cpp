@@ -0,0 +1,100 @@
+/**
+ * @file      acitracedump.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @brief     Prints a binary instruction trace in the text format of the
+ *            simulator traces: one hexadecimal PC per line.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+
+#include "ac_instr_trace.H"
+
+static void usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [-n] [-m] <binary trace> [<text trace>]\n"
+            << "Prints a binary instruction trace as text, one PC per line.\n"
+            << "  -n  Append the instruction name to each PC\n"
+            << "  -m  Print the memory accesses (r|w <address> <size> <value>)\n";
+}
+
+int main(int argc, char* argv[])
+{
+  bool show_names = false;
+  bool show_memory = false;
+  int arg = 1;
+
+  for (; (arg < argc) && (argv[arg][0] == '-') && argv[arg][1]; arg++) {
+    if (!strcmp(argv[arg], "-n"))
+      show_names = true;
+    else if (!strcmp(argv[arg], "-m"))
+      show_memory = true;
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if ((argc - arg < 1) || (argc - arg > 2)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream in(argv[arg], std::ios::in | std::ios::binary);
+  if (!in) {
+    std::cerr << "Error opening file: " << argv[arg] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  ac_instr_trace_reader reader(in);
+  if (!reader.good()) {
+    std::cerr << "Error: " << argv[arg] << " is not a binary instruction trace\n";
+    return EXIT_FAILURE;
+  }
+
+  FILE* out = stdout;
+  if ((argc - arg == 2) && !(out = fopen(argv[arg + 1], "w"))) {
+    std::cerr << "Error opening file: " << argv[arg + 1] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  ac_instr_trace_record r;
+  while (reader.next(r)) {
+    if (r.kind == AC_ITRACE_INSTR) {
+      if (show_names)
+        fprintf(out, "%x %s\n", r.pc, reader.get_name(r.id));
+      else
+        fprintf(out, "%x\n", r.pc);
+    }
+    else if (show_memory)
+      fprintf(out, "  %c %x %u %llx\n", (r.kind == AC_ITRACE_WRITE) ? 'w' : 'r',
+              r.address, r.size, r.value);
+  }
+
+  if ((out != stdout) ? (fclose(out) != 0) : (fflush(out) != 0)) {
+    std::cerr << "Error writing the text trace\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
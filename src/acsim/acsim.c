@@ -63,7 +63,7 @@
 
 
 //Defining Traces and Dasm strings
-#define PRINT_TRACE "%strace_file << hex << ac_pc << dec <<\"\\n\";\n"
+#define PRINT_TRACE "%sif (ac_bin_trace) ac_bin_trace->add(ac_pc, ins_id);\n%selse trace_file << hex << ac_pc << dec <<\"\\n\";\n"
 
 //Command-line options flags
 int  ACABIFlag=0;                               //!<Indicates whether an ABI was provided or not
@@ -85,6 +85,12 @@ int  ACPCAddress=1;                             //!<Indicates if PC bounds is ve
 int  ACFullDecode=0;                            //!<Indicates if Full Decode Optimization is turned on or not
 int  ACCurInstrID=1;                            //!<Indicates if Current Instruction ID is save in dispatch
 int  ACPowerEnable=0;                           //!<Indicates if Power Estimation is enabled
+int  ACBlockChaining=0;                         //!<Indicates if Basic Block Chaining is turned on or not
+int  ACProfileFlag=0;                           //!<Indicates if the basic block profiler is compiled in
+int  ACGDBTraps=0;                              //!<Indicates if GDB breakpoints patch the decoder cache instead of being checked on every instruction
+int  ACCheckpointFlag=0;                        //!<Indicates if architectural checkpoints are compiled in
+int  ACSamplingFlag=0;                          //!<Indicates if sampled simulation is compiled in
+int  ACCosimFlag=0;                             //!<Indicates if the differential co-simulation hooks are compiled in
 
 char ACOptions[500];                            //!<Stores ArchC recognized command line options
 char *ACOptions_p = ACOptions;                  //!<Pointer used to append options in ACOptions
@@ -140,6 +146,11 @@ struct option_map option_map[] = {
   {"--full-decode"     , "-fdc","Enable Full Decode Optimization.", 0},
   {"--no-curr-instr-id", "-nci","Disable Current Instruction ID save in dispatch.", 0},
   {"--power"           , "-pw" ,"Enable Power Estimation.", 0},
+  {"--block-chaining"  , "-bc" ,"Enable Basic Block Chaining in the threaded interpreter.", 0},
+  {"--profile"         , "-pf" ,"Enable the basic block profiler (hot regions, SimPoint vectors).", 0},
+  {"--checkpoint"      , "-ckp","Enable architectural checkpoints (--checkpoint and --restore at run time).", 0},
+  {"--sampling"        , "-smp","Enable sampled simulation (--sample at run time).", 0},
+  {"--cosim"           , "-cos","Enable differential co-simulation (ac_cosim).", 0},
   { }
 };
 
@@ -373,6 +384,27 @@ int main(int argc, char** argv) {
             case OPPower:
               ACPowerEnable = 1;
               ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPBlockChaining:
+              ACBlockChaining = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPProfile:
+              ACProfileFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPCheckpoint:
+              ACCheckpointFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPSampling:
+              ACSamplingFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPCosim:
+              ACCosimFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
             default:
               break;
           }
@@ -390,6 +422,19 @@ int main(int argc, char** argv) {
   
   if ( !ACDecCacheFlag ) ACFullDecode = 0;
 
+  //Block chaining walks DecCacheItem runs through the threaded dispatch.
+  //Delayed assignments must be committed on every instruction, so they
+  //cannot share the per-block update.
+  if ( ACBlockChaining && (!ACThreading || !ACDecCacheFlag || ACDelayFlag) ) {
+    AC_MSG("Warning: Block chaining requires threading and decoder cache and cannot be used with delayed assignments. Disabling it.\n");
+    ACBlockChaining = 0;
+  }
+
+  //GDB breakpoints replace the interpretation routine of the decoded
+  //instruction, so they can only be trapped by threaded simulators with
+  //decoder cache. The others check every instruction.
+  ACGDBTraps = ACGDBIntegrationFlag && ACThreading && ACDecCacheFlag;
+
   //Loading Configuration Variables
   ReadConfFile();
 
@@ -1070,6 +1115,12 @@ void CreateParmHeader() {
   
   if( ACLongJmpStop || ACThreading )
     fprintf( output, "#define  AC_ACTION_STOP 2\t //!< Indicates action value to stop used by longjmp.\n\n");
+
+  if( ACBlockChaining )
+    fprintf( output, "#define  AC_BLOCK_CHAINING \t //!< Indicates that basic block chaining is turned on.\n\n");
+
+  if( ACCheckpointFlag )
+    fprintf( output, "#define  AC_CHECKPOINT \t //!< Indicates that checkpoints are turned on.\n\n");
   
   /* parms namespace definition */
   fprintf(output, "namespace %s_parms {\n\n", project_name);
@@ -1097,6 +1148,12 @@ void CreateParmHeader() {
   fprintf( output, "static const unsigned int AC_RAM_END = %uU; \t //!< Architecture end of RAM (storage %s).\n", 
            load_device->size, load_device->name);
 
+  if (ACDecCacheFlag)
+  fprintf( output, "static const unsigned int AC_DEC_CACHE_PAGE_BITS = 12; \t //!< log2 of the number of decoder cache items per page.\n");
+
+  if (ACBlockChaining)
+  fprintf( output, "static const unsigned int AC_MAX_BLOCK_SIZE = 64; \t //!< Maximum number of instructions chained between block checks.\n");
+
   if (ACGDBIntegrationFlag)
   fprintf( output, "static const unsigned int GDB_PORT_NUM = 5000; \t //!< GDB port number.\n");
 
@@ -1539,6 +1596,11 @@ void CreateProcessorHeader() {
   fprintf( output, "#include \"systemc.h\"\n");
   fprintf( output, "#include \"ac_module.H\"\n");
   fprintf( output, "#include \"ac_utils.H\"\n");
+  fprintf( output, "#include \"ac_checkpoint.H\"\n");
+  if (ACSamplingFlag)
+    fprintf( output, "#include \"ac_sampling.H\"\n");
+  if (ACProfileFlag)
+    fprintf( output, "#include \"ac_profiler.H\"\n");
 #ifdef HLT_SUPPORT
   fprintf( output, "#include \"ac_hltrace.H\"\n");
 #endif
@@ -1570,8 +1632,13 @@ if (HaveTLM2IntrPorts) {
   if(ACGDBIntegrationFlag) {
     fprintf( output, "#include \"ac_gdb_interface.H\"\n");
     fprintf( output, "#include \"ac_gdb.H\"\n");
+    if (ACGDBTraps)
+      fprintf( output, "#include <map>\n");
   }
 
+  if (ACVerboseFlag)
+    fprintf( output, "#ifdef AC_VERIFY\n#include \"ac_verify_link.H\"\n#endif\n");
+
   fprintf(output, "\n\nclass %s: public ac_module, public %s_arch", 
           project_name, project_name);
   if (ACGDBIntegrationFlag)
@@ -1639,18 +1706,51 @@ if (HaveTLM2IntrPorts) {
   }
   
   if(ACDecCacheFlag){
-    fprintf( output, "%sDecCacheItem* DEC_CACHE;\n", INDENT[1]);
+    COMMENT(INDENT[1], "Decoder cache page table. Pages are allocated on first fetch.");
+    fprintf( output, "%sDecCacheItem** DEC_CACHE;\n", INDENT[1]);
     fprintf( output, "%sDecCacheItem* instr_dec;\n", INDENT[1]);
   }
   else
     fprintf( output, "%sunsigned* ins_cache;\n", INDENT[1]);
 
+  COMMENT(INDENT[1], "Fields of the last decoded instruction, filled by the decoder.");
+  fprintf( output, "%sunsigned dec_fields[%s_parms::AC_DEC_FIELD_NUMBER];\n", INDENT[1], project_name);
+
+  if (ACBlockChaining) {
+    COMMENT(INDENT[1], "Fall-through address and remaining length of the current basic block.");
+    fprintf( output, "%sunsigned chain_pc;\n", INDENT[1]);
+    fprintf( output, "%sunsigned chain_left;\n", INDENT[1]);
+    COMMENT(INDENT[1], "Instruction whose block chain() could not follow, linked by dispatch().");
+    fprintf( output, "%sDecCacheItem* chain_from;\n", INDENT[1]);
+  }
+
+  if (ACProfileFlag) {
+    COMMENT(INDENT[1], "Basic block profiler, entered when ac_pc is not the fall-through address.");
+    fprintf( output, "%sac_profiler profiler;\n", INDENT[1]);
+    if (!ACBlockChaining)
+      fprintf( output, "%sunsigned profile_pc;\n", INDENT[1]);
+    if (ACDecCacheFlag)
+      fprintf( output, "%sstatic bool profile_decode(void* context, unsigned pc, unsigned& id);\n", INDENT[1]);
+  }
+
   //fprintf( output, "%sunsigned id;\n", INDENT[1]);
   fprintf( output, "%sbool start_up;\n", INDENT[1]);
 
   if (ACGDBIntegrationFlag)
     fprintf(output, "%sAC_GDB<%s_parms::ac_word>* gdbstub;\n\n", 
             INDENT[1], project_name);
+
+  if (ACGDBTraps) {
+    COMMENT(INDENT[1], "GDB breakpoints: their decoded instructions jump to TrapRoutine, gdb_traps keeps the routines replaced.");
+    fprintf( output, "%svoid* TrapRoutine;\n", INDENT[1]);
+    fprintf( output, "%sstd::map<unsigned, void*> gdb_traps;\n", INDENT[1]);
+    COMMENT(INDENT[1], "Instruction count of the last GDB stop.");
+    fprintf( output, "%sunsigned long long gdb_stopped_at;\n", INDENT[1]);
+    fprintf( output, "%svoid gdb_stop(unsigned long long next);\n", INDENT[1]);
+    fprintf( output, "%svoid gdb_step();\n", INDENT[1]);
+    fprintf( output, "%svoid* gdb_trap();\n", INDENT[1]);
+    fprintf( output, "%svoid set_breakpoint_trap(unsigned int address, bool insert);\n\n", INDENT[1]);
+  }
   
   fprintf( output, "\n");
   
@@ -1660,6 +1760,13 @@ if (HaveTLM2IntrPorts) {
              "%sinline __attribute__((always_inline)) void* dispatch();\n\n", 
              INDENT[1]);
   }
+
+  if (ACBlockChaining) {
+    COMMENT(INDENT[1], "Chain Method.");
+    fprintf( output, 
+             "%sinline __attribute__((always_inline)) void* chain();\n\n", 
+             INDENT[1]);
+  }
   
   COMMENT(INDENT[1], "Behavior execution method.");
   fprintf( output, "%svoid behavior();\n\n", INDENT[1]);
@@ -1667,6 +1774,11 @@ if (HaveTLM2IntrPorts) {
   if (ACVerboseFlag) {
     COMMENT(INDENT[1], "Verification method.");
     fprintf( output, "%svoid ac_verify();\n\n", INDENT[1]);
+
+    fprintf( output, "#ifdef AC_VERIFY\n");
+    COMMENT(INDENT[1], "Update stream to acverifier.");
+    fprintf( output, "%sac_verify_writer ac_verify_link;\n", INDENT[1]);
+    fprintf( output, "#endif\n\n");
   }
 
   fprintf( output, "%sSC_HAS_PROCESS( %s );\n\n", INDENT[1], project_name);
@@ -1718,7 +1830,7 @@ if (HaveTLM2IntrPorts) {
 
   fprintf(output, " {\n");
 
-  fprintf( output, "%sSC_THREAD( behavior );\n", INDENT[2]);
+  fprintf( output, "%sSC_THREAD( host_behavior );\n", INDENT[2]);
   fprintf( output, "%ssensitive << wake;\n", INDENT[2]);
 
   if (ACVerboseFlag) {
@@ -1736,6 +1848,12 @@ if (HaveTLM2IntrPorts) {
     fprintf(output, "%sgdbstub = new AC_GDB<%s_parms::ac_word>(this, %s_parms::GDB_PORT_NUM);\n\n", 
             INDENT[2], project_name, project_name);
 
+  if (ACGDBTraps)
+    fprintf(output, "%sgdb_stopped_at = ~0ULL;\n\n", INDENT[2]);
+
+  if (ACBlockChaining)
+    fprintf(output, "%schain_from = NULL;\n\n", INDENT[2]);
+
   if (ACWaitFlag)
     fprintf(output, "%sset_proc_freq(1000/module_period_ns);\n", INDENT[2]);
 
@@ -1743,11 +1861,40 @@ if (HaveTLM2IntrPorts) {
 
   if(ACDecCacheFlag) {
     fprintf( output, "%svoid init_dec_cache() {\n", INDENT[1]);
-    fprintf( output, "%sDEC_CACHE = (DecCacheItem*) calloc(sizeof(DecCacheItem), (dec_cache_size", 
+    fprintf( output, "%sDEC_CACHE = (DecCacheItem**) calloc(sizeof(DecCacheItem*), ((dec_cache_size", 
              INDENT[2]);
     if( ACIndexFix ) fprintf( output, " / %d", largest_format_size / 8);
-    fprintf( output, "));\n");
+    fprintf( output, ") >> %s_parms::AC_DEC_CACHE_PAGE_BITS) + 1);\n", project_name);
+    if( !ACFullDecode ) {
+      fprintf( output, "%scode_page_count = (dec_cache_size >> code_page_bits) + 2;\n", INDENT[2]);
+      fprintf( output, "%scode_page_map = (unsigned char*) calloc(sizeof(unsigned char), code_page_count);\n", 
+               INDENT[2]);
+    }
     fprintf( output, "%s}\n\n", INDENT[1]);  //end init_dec_cache
+
+    COMMENT(INDENT[1], "Returns the decoder cache item at index, allocating its page on first use.");
+    fprintf( output, "%sinline __attribute__((always_inline)) DecCacheItem* dec_cache_at(unsigned index) {\n", 
+             INDENT[1]);
+    fprintf( output, "%sDecCacheItem*& page = DEC_CACHE[index >> %s_parms::AC_DEC_CACHE_PAGE_BITS];\n", 
+             INDENT[2], project_name);
+    fprintf( output, "%sif (__builtin_expect(page == NULL, 0))\n", INDENT[2]);
+    fprintf( output, "%spage = (DecCacheItem*) calloc(sizeof(DecCacheItem), 1U << %s_parms::AC_DEC_CACHE_PAGE_BITS);\n", 
+             INDENT[3], project_name);
+    fprintf( output, "%sreturn page + (index & ((1U << %s_parms::AC_DEC_CACHE_PAGE_BITS) - 1));\n", 
+             INDENT[2], project_name);
+    fprintf( output, "%s}\n\n", INDENT[1]);  //end dec_cache_at
+
+    if( !ACFullDecode ) {
+      COMMENT(INDENT[1], "Flags the guest page holding address as containing decoded code.");
+      fprintf( output, "%sinline __attribute__((always_inline)) void mark_code_page(unsigned address) {\n", 
+               INDENT[1]);
+      fprintf( output, "%sif ((address >> code_page_bits) < code_page_count)\n", INDENT[2]);
+      fprintf( output, "%scode_page_map[address >> code_page_bits] = 1;\n", INDENT[3]);
+      fprintf( output, "%s}\n\n", INDENT[1]);  //end mark_code_page
+
+      COMMENT(INDENT[1], "Drops the decoded instructions of a code page written by the program.");
+      fprintf( output, "%svoid invalidate_code_page(unsigned page);\n\n", INDENT[1]);
+    }
   }
 
   if(ACGDBIntegrationFlag) {
@@ -1786,6 +1933,18 @@ if (HaveTLM2IntrPorts) {
   fprintf( output, "%sunsigned get_ac_pc();\n\n", INDENT[1]);
   fprintf( output, "%svoid set_ac_pc( unsigned int value );\n\n", INDENT[1]);
   fprintf( output, "%svirtual void PrintStat();\n\n", INDENT[1]);
+  if (ACCheckpointFlag) {
+    fprintf( output, "%sbool save_checkpoint(const char* file);\n\n", INDENT[1]);
+    fprintf( output, "%sbool restore_checkpoint(const char* file);\n\n", INDENT[1]);
+    fprintf( output, "%svoid take_checkpoint();\n\n", INDENT[1]);
+    fprintf( output, "%svirtual void RequestCheckpoint();\n\n", INDENT[1]);
+  }
+  if (ACCosimFlag)
+    fprintf( output, "%svoid cosim_state(ac_cosim_state& state);\n\n", INDENT[1]);
+  if (ACSamplingFlag) {
+    fprintf( output, "%sac_sampler sampler;\n\n", INDENT[1]);
+    fprintf( output, "%svoid sample_phase();\n\n", INDENT[1]);
+  }
   fprintf( output, "%svoid init(int ac, char* av[]);\n\n", INDENT[1]);
   fprintf( output, "%svoid init();\n\n", INDENT[1]);
   fprintf( output, "%svoid set_prog_args();\n\n", INDENT[1]);
@@ -1793,8 +1952,12 @@ if (HaveTLM2IntrPorts) {
   fprintf( output, "%svoid delayed_load(char* program);\n\n", INDENT[1]);
   fprintf( output, "%svoid stop(int status = 0);\n\n", INDENT[1]);
 
-  if (ACGDBIntegrationFlag)
+  if (ACGDBIntegrationFlag) {
     fprintf(output, "%svoid enable_gdb(int port = 5000);\n\n", INDENT[1]);
+    fprintf(output, "%sbool set_watchpoint(unsigned int address, unsigned int length, int type, bool insert);\n", INDENT[1]);
+    fprintf(output, "%svoid watchpoint_hit(int type, unsigned address);\n", INDENT[1]);
+    fprintf(output, "%sconst char* target_description();\n\n", INDENT[1]);
+  }
 
   fprintf( output, "%svirtual ~%s() {};\n\n", INDENT[1], project_name);
 
@@ -1894,6 +2057,18 @@ void CreateRegsHeader() {
 
       fprintf( output,"%svoid change_dump(ostream& output){}\n\n",INDENT[1] );
       fprintf( output,"%svoid reset_log(){}\n\n",INDENT[1] );
+      fprintf( output,"%svoid save(ac_checkpoint_writer& ckpt, const char* key) {\n",INDENT[1] );
+      for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+        fprintf( output,"%s%s.save(ckpt, (string(key) + \".%s\").c_str());\n",
+                 INDENT[2], pfield->name, pfield->name);
+      fprintf( output,"%s}\n\n",INDENT[1] );
+      fprintf( output,"%sbool restore(ac_checkpoint_reader& ckpt, const char* key) {\n",INDENT[1] );
+      fprintf( output,"%sbool ok = true;\n",INDENT[2] );
+      for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+        fprintf( output,"%sok &= %s.restore(ckpt, (string(key) + \".%s\").c_str());\n",
+                 INDENT[2], pfield->name, pfield->name);
+      fprintf( output,"%sreturn ok;\n",INDENT[2] );
+      fprintf( output,"%s}\n\n",INDENT[1] );
       if (ACDelayFlag) {
         fprintf( output,"%svoid commit_delays(double time)\n",INDENT[1] );
         fprintf( output,"%s{\n",INDENT[1] );
@@ -1901,6 +2076,12 @@ void CreateRegsHeader() {
           fprintf( output,"%s%s.commit_delays(time);\n", 
                    INDENT[2], pfield->name);
         }
+        fprintf( output,"%s}\n\n",INDENT[1] );
+        fprintf( output,"%svoid set_delay_mask(unsigned long long& mask, unsigned bit)\n",INDENT[1] );
+        fprintf( output,"%s{\n",INDENT[1] );
+        for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+          fprintf( output,"%s%s.set_delay_mask(mask, bit++);\n", 
+                   INDENT[2], pfield->name);
         fprintf( output,"%s}\n",INDENT[1] );
       }
       fprintf( output, "};\n\n");
@@ -2055,7 +2236,10 @@ void CreateProcessorImpl() {
 
     print_comment( output, "Processor Module Implementation File.");
     fprintf( output, "#include  \"%s.H\"\n", project_name);
-    fprintf( output, "#include  \"%s_isa.cpp\"\n\n", project_name);
+    fprintf( output, "#include  \"%s_isa.cpp\"\n", project_name);
+    if (ACCosimFlag)
+      fprintf( output, "#include  \"ac_cosim.H\"\n");
+    fprintf( output, "\n");
 
     if( ACABIFlag )
         fprintf( output, "#include  \"%s_syscall.H\"\n\n", project_name);
@@ -2063,6 +2247,12 @@ void CreateProcessorImpl() {
     if( ACThreading )
         EmitDispatch(output, 0);
 
+    if( ACBlockChaining )
+        EmitChain(output, 0);
+
+    if( ACGDBTraps )
+        EmitGDBTraps(output, 0);
+
     fprintf( output, "void %s::behavior() {\n\n", project_name);
     if( ACDebugFlag ){
         fprintf( output, "%sextern bool ac_do_trace;\n", INDENT[1]);
@@ -2096,10 +2286,10 @@ void CreateProcessorImpl() {
 
     if ( ACThreading && ACABIFlag && ACDecCacheFlag) {
         fprintf( output, "%s#define AC_SYSC(NAME,LOCATION) \\\n", INDENT[1]);
-        fprintf( output, "%sinstr_dec = (DEC_CACHE + (LOCATION", INDENT[1]);
+        fprintf( output, "%sinstr_dec = dec_cache_at(LOCATION", INDENT[1]);
         if( ACIndexFix ) 
             fprintf( output, " / %d", largest_format_size / 8);
-        fprintf( output, ")); \\\n");
+        fprintf( output, "); \\\n");
 
         if ( !ACFullDecode )
             fprintf( output, "%sinstr_dec->valid = true; \\\n", INDENT[1]);
@@ -2139,6 +2329,11 @@ void CreateProcessorImpl() {
         }
         fprintf( output, "#endif\n");
 
+        fprintf( output, "#ifdef AC_VERIFY\n");
+        EmitVerifyStorages(output, 2, 0);
+        fprintf( output, "%sac_verify_link.flush();\n", INDENT[2]);
+        fprintf( output, "#endif\n");
+
         fprintf( output, "#ifdef AC_UPDATE_LOG\n");
         for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next){
             fprintf( output, "%s%s.reset_log();\n", 
@@ -2168,19 +2363,37 @@ void CreateProcessorImpl() {
             case ICACHE:
             case DCACHE:
                 fprintf(output, "%sif (ac_cache_traces.find(\"%s\") != ac_cache_traces.end()) "
-                        "%s.set_trace(*ac_cache_traces[\"%s\"]);\n",
-                        INDENT[1], pstorage->name, pstorage->name, pstorage->name);
+                        "%s.set_trace(*ac_cache_traces[\"%s\"], ac_cache_binary_traces.count(\"%s\") != 0);\n",
+                        INDENT[1], pstorage->name, pstorage->name, pstorage->name, pstorage->name);
             default: 
                 continue;
         }
 
     }
 
-    fprintf(output, "\n#ifdef AC_VERIFY\n");
-    fprintf(output, "%sset_queue(av[0]);\n", INDENT[1]);
-    fprintf(output, "#endif\n\n");
+    if (ACVerboseFlag) {
+        fprintf(output, "\n#ifdef AC_VERIFY\n");
+        fprintf(output, "%sif (ac_verify_link.open()) {\n", INDENT[1]);
+        EmitVerifyStorages(output, 2, 1);
+        fprintf(output, "%sac_verify_link.start();\n", INDENT[2]);
+        fprintf(output, "%s}\n", INDENT[1]);
+        fprintf(output, "#endif\n\n");
+    }
     fprintf(output, "%sac_pc = ac_start_addr;\n", INDENT[1]);
     fprintf(output, "%sISA._behavior_begin();\n", INDENT[1]);
+    EmitCheckpointInit(output, 1);
+    EmitSamplingInit(output, 1);
+    if (ACDebugFlag) {
+      fprintf(output, "%sif (!ac_trace_bin_path.empty() && !ac_trace_binary(ac_trace_bin_path.c_str(), ISA.instr_table, %s_parms::AC_DEC_INSTR_NUMBER + 1))\n", 
+              INDENT[1], project_name);
+      fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+    }
+    if (ACProfileFlag) {
+      fprintf(output, "%s%s = ~0U;\n", INDENT[1], ACBlockChaining ? "chain_pc" : "profile_pc");
+      fprintf(output, "%sif (!ac_profile_bbv_path.empty() && !profiler.open_bbv(ac_profile_bbv_path.c_str(), ac_profile_interval))\n", 
+              INDENT[1]);
+      fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+    }
     fprintf(output, "%scerr << endl << \"ArchC: -------------------- Starting Simulation --------------------\" << endl;\n", 
             INDENT[1]);
     fprintf(output, "%sInitStat();\n", INDENT[1]);
@@ -2197,6 +2410,10 @@ void CreateProcessorImpl() {
     fprintf(output, "%ssignal(SIGUSR1, sigusr1_handler);\n", INDENT[1]);
     fprintf(output, "#ifdef USE_GDB\n");
     fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
+    if (ACCheckpointFlag) {
+      fprintf(output, "#else\n");
+      fprintf(output, "%ssignal(SIGUSR2, sigcheckpoint_handler);\n", INDENT[1]);
+    }
     fprintf(output, "#endif\n");
     fprintf(output, "%sset_running();\n", INDENT[1]);
     fprintf(output, "}\n\n");
@@ -2214,19 +2431,37 @@ void CreateProcessorImpl() {
             case ICACHE:
             case DCACHE:
                 fprintf(output, "%sif (ac_cache_traces.find(\"%s\") != ac_cache_traces.end()) "
-                        "%s.set_trace(*ac_cache_traces[\"%s\"]);\n",
-                        INDENT[1], pstorage->name, pstorage->name, pstorage->name);
+                        "%s.set_trace(*ac_cache_traces[\"%s\"], ac_cache_binary_traces.count(\"%s\") != 0);\n",
+                        INDENT[1], pstorage->name, pstorage->name, pstorage->name, pstorage->name);
 
             default: continue;
 
         }
     }
 
-    fprintf(output, "#ifdef AC_VERIFY\n");
-    fprintf(output, "%sset_queue(av[0]);\n", INDENT[1]);
-    fprintf(output, "#endif\n\n");
+    if (ACVerboseFlag) {
+        fprintf(output, "#ifdef AC_VERIFY\n");
+        fprintf(output, "%sif (ac_verify_link.open()) {\n", INDENT[1]);
+        EmitVerifyStorages(output, 2, 1);
+        fprintf(output, "%sac_verify_link.start();\n", INDENT[2]);
+        fprintf(output, "%s}\n", INDENT[1]);
+        fprintf(output, "#endif\n\n");
+    }
     fprintf(output, "%sac_pc = ac_start_addr;\n", INDENT[1]);
     fprintf(output, "%sISA._behavior_begin();\n", INDENT[1]);
+    EmitCheckpointInit(output, 1);
+    EmitSamplingInit(output, 1);
+    if (ACDebugFlag) {
+      fprintf(output, "%sif (!ac_trace_bin_path.empty() && !ac_trace_binary(ac_trace_bin_path.c_str(), ISA.instr_table, %s_parms::AC_DEC_INSTR_NUMBER + 1))\n", 
+              INDENT[1], project_name);
+      fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+    }
+    if (ACProfileFlag) {
+      fprintf(output, "%s%s = ~0U;\n", INDENT[1], ACBlockChaining ? "chain_pc" : "profile_pc");
+      fprintf(output, "%sif (!ac_profile_bbv_path.empty() && !profiler.open_bbv(ac_profile_bbv_path.c_str(), ac_profile_interval))\n", 
+              INDENT[1]);
+      fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+    }
     fprintf(output, "%scerr << endl << \"ArchC: -------------------- Starting Simulation --------------------\" << endl;\n", 
             INDENT[1]);
     fprintf(output, "%sInitStat();\n", INDENT[1]);
@@ -2243,6 +2478,10 @@ void CreateProcessorImpl() {
     fprintf(output, "%ssignal(SIGUSR1, sigusr1_handler);\n", INDENT[1]);
     fprintf(output, "#ifdef USE_GDB\n");
     fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
+    if (ACCheckpointFlag) {
+      fprintf(output, "#else\n");
+      fprintf(output, "%ssignal(SIGUSR2, sigcheckpoint_handler);\n", INDENT[1]);
+    }
     fprintf(output, "#endif\n");
     fprintf(output, "%sset_running();\n", INDENT[1]);
     fprintf(output, "}\n\n");
@@ -2257,6 +2496,12 @@ void CreateProcessorImpl() {
 
     fprintf(output, "%scerr << endl << \"ArchC: -------------------- Simulation Finished --------------------\" << endl;\n", 
             INDENT[1]);
+    if (ACVerboseFlag) {
+        fprintf(output, "#ifdef AC_VERIFY\n");
+        EmitVerifyStorages(output, 1, 0);
+        fprintf(output, "%sac_verify_link.finish();\n", INDENT[1]);
+        fprintf(output, "#endif\n");
+    }
     fprintf(output, "%sISA._behavior_end();\n", INDENT[1]);
     fprintf(output, "%sac_stop_flag = 1;\n", INDENT[1]);
     fprintf(output, "%sac_exit_status = status;\n", INDENT[1]);
@@ -2313,6 +2558,84 @@ void CreateProcessorImpl() {
     fprintf(output, "%sac_pc = value;\n", INDENT[1]);
     fprintf(output, "}\n\n");
 
+    /* invalidate_code_page() */
+    if( ACDecCacheFlag && !ACFullDecode ) {
+      fprintf(output, "// Drops the decoded instructions of a code page written by the program\n");
+      fprintf(output, "void %s::invalidate_code_page(unsigned page) {\n", project_name);
+      fprintf(output, "%sunsigned pages = ((dec_cache_size", INDENT[1]);
+      if( ACIndexFix ) fprintf( output, " / %d", largest_format_size / 8);
+      fprintf(output, ") >> %s_parms::AC_DEC_CACHE_PAGE_BITS) + 1;\n", project_name);
+      fprintf(output, "%sunsigned first = page << code_page_bits;\n", INDENT[1]);
+      fprintf(output, "%sunsigned last = ((page + 1) << code_page_bits) - 1;\n\n", INDENT[1]);
+      if( largest_format_size > 8 ) {
+        //mark_code_page() flags both pages of an instruction crossing
+        //the boundary, so the write may only hit its tail.
+        COMMENT(INDENT[1], "Instructions starting on the previous page may end on this one.");
+        fprintf(output, "%sfirst = (first > %d) ? first - %d : 0;\n", INDENT[1], 
+                largest_format_size / 8 - 1, largest_format_size / 8 - 1);
+      }
+      if( ACIndexFix ) {
+        fprintf(output, "%sfirst /= %d;\n", INDENT[1], largest_format_size / 8);
+        fprintf(output, "%slast /= %d;\n", INDENT[1], largest_format_size / 8);
+      }
+      fprintf(output, "\n");
+      if( ACThreading && ACABIFlag ) {
+        COMMENT(INDENT[1], "Keep the syscall entries set up by AC_SYSC.");
+        fprintf(output, "%sif (first < 0x100", INDENT[1]);
+        if( ACIndexFix ) fprintf( output, " / %d", largest_format_size / 8);
+        fprintf(output, ") first = 0x100");
+        if( ACIndexFix ) fprintf( output, " / %d", largest_format_size / 8);
+        fprintf(output, ";\n");
+      }
+      if( ACBlockChaining ) {
+        int step = ACIndexFix ? 1 : largest_format_size / 8;
+
+        COMMENT(INDENT[1], "chain() follows succ links unchecked: unlink the instructions before the dropped ones too.");
+        fprintf(output, "%sunsigned linked = (first > %d) ? first - %d : 0;\n\n", INDENT[1], step, step);
+      }
+      fprintf(output, "%sfor (unsigned index = %s; index <= last; index++) {\n", INDENT[1], 
+              ACBlockChaining ? "linked" : "first");
+      fprintf(output, "%sif ((index >> %s_parms::AC_DEC_CACHE_PAGE_BITS) >= pages)\n", 
+              INDENT[2], project_name);
+      fprintf(output, "%sbreak;\n", INDENT[3]);
+      fprintf(output, "%sDecCacheItem* items = DEC_CACHE[index >> %s_parms::AC_DEC_CACHE_PAGE_BITS];\n", 
+              INDENT[2], project_name);
+      if( ACBlockChaining ) {
+        fprintf(output, "%sif (items) {\n", INDENT[2]);
+        fprintf(output, "%sDecCacheItem* item = items + (index & ((1U << %s_parms::AC_DEC_CACHE_PAGE_BITS) - 1));\n\n", 
+                INDENT[3], project_name);
+        fprintf(output, "%sitem->succ = NULL;\n", INDENT[3]);
+        fprintf(output, "%sif (index >= first)\n", INDENT[3]);
+        fprintf(output, "%sitem->valid = false;\n", INDENT[4]);
+        fprintf(output, "%s}\n", INDENT[2]);
+      }
+      else {
+        fprintf(output, "%sif (items)\n", INDENT[2]);
+        fprintf(output, "%sitems[index & ((1U << %s_parms::AC_DEC_CACHE_PAGE_BITS) - 1)].valid = false;\n", 
+                INDENT[3], project_name);
+      }
+      fprintf(output, "%s}\n\n", INDENT[1]);
+      fprintf(output, "%scode_page_map[page] = 0;\n", INDENT[1]);
+      fprintf(output, "%sdec_cache_invalidations++;\n", INDENT[1]);
+      fprintf(output, "}\n\n");
+    }
+
+    /* Checkpoints */
+    if (ACCheckpointFlag)
+      EmitCheckpoint(output, 0);
+
+    /* Differential co-simulation */
+    if (ACCosimFlag)
+      EmitCosimState(output, 0);
+
+    /* Sampled simulation */
+    if (ACSamplingFlag)
+      EmitSampling(output, 0);
+
+    /* Basic block profiler */
+    if (ACProfileFlag && ACDecCacheFlag)
+      EmitProfileDecode(output, 0);
+
     /* PrintStat() */
     fprintf(output, "// Wrapper function to PrintStat().\n");
     fprintf(output, "void %s::PrintStat() {\n", project_name);
@@ -2336,7 +2659,11 @@ void CreateProcessorImpl() {
         }
     }
 
-
+    if (ACProfileFlag) {
+      fprintf(output, "%sprofiler.finish(ac_instr_counter);\n", INDENT[1]);
+      fprintf(output, "%sprofiler.report(std::cerr, appfilename, ac_mt_endian, %s, this, ISA.instr_table);\n", 
+              INDENT[1], ACDecCacheFlag ? "profile_decode" : "NULL");
+    }
 
     fprintf(output, "}\n\n");
 
@@ -2365,6 +2692,29 @@ void CreateProcessorImpl() {
         fprintf(output, "%sgdbstub->set_port(port);\n", INDENT[1]);
         fprintf(output, "%sgdbstub->enable();\n", INDENT[1]);
         fprintf(output, "%sgdbstub->connect();\n", INDENT[1]);
+        if (ACGDBTraps)
+            fprintf(output, "%sac_trap_at = 0;\n", INDENT[1]);
+        fprintf(output, "}\n\n");
+
+        EmitGDBTargetDescription(output, 0);
+
+        fprintf(output, "// Watchpoints are set on the data memory port\n");
+        fprintf(output, "bool %s::set_watchpoint(unsigned int address, unsigned int length, int type, bool insert) {\n", 
+                project_name);
+        fprintf(output, "%sreturn DATA_PORT && DATA_PORT->set_watchpoint(address, length, type, insert);\n", INDENT[1]);
+        fprintf(output, "}\n\n");
+
+        fprintf(output, "// Stops before the next instruction after a watchpoint hit\n");
+        fprintf(output, "void %s::watchpoint_hit(int type, unsigned address) {\n", project_name);
+        if (ACGDBTraps) {
+            fprintf(output, "%sif (gdbstub->watch_hit(type, address)) {\n", INDENT[1]);
+            fprintf(output, "%sac_trap_at = ac_instr_counter;\n", INDENT[2]);
+            if (ACBlockChaining)
+                fprintf(output, "%schain_left = 1;\n", INDENT[2]);
+            fprintf(output, "%s}\n", INDENT[1]);
+        }
+        else
+            fprintf(output, "%sgdbstub->watch_hit(type, address);\n", INDENT[1]);
         fprintf(output, "}\n\n");
     }
 
@@ -2525,6 +2875,21 @@ void CreateArchImpl() {
         }
     }
 
+    //Bits of the storage devices in the pending delayed writes mask
+    if (ACDelayFlag) {
+        int bit = 0;
+
+        for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next) {
+            int queues = DelayQueues(pstorage);
+
+            if (queues && (bit < 64))
+                fprintf(output, "%s%s%s.set_delay_mask(ac_delay_mask, %d);\n", INDENT[1],
+                        pstorage->name, pstorage->has_memport ? "_mport" : "", bit);
+            bit += queues;
+        }
+        fprintf(output, "%sac_pc.set_delay_mask(ac_delay_mask, %d);\n", INDENT[1], bit);
+    }
+
     fprintf(output, "%sINST_PORT = &%s_mport;\n", INDENT[1], fetch_device->name);
 
     fprintf(output, "%sDATA_PORT = &%s_mport;\n", INDENT[1], first_level_data_device->name);
@@ -3252,7 +3617,8 @@ void CreateMakefile(){
   fprintf( output, "LIB_ARCHC := `pkg-config --libs archc`\n");
   fprintf( output, "LIB_POWERSC := %s\n", (ACPowerEnable) ? "`pkg-config --libs powersc`" : "");
   fprintf( output, "LIB_DWARF := %s\n", (ACHLTraceFlag) ? "-ldw -lelf" : "" );
-  fprintf( output, "LIBS := $(LIB_SYSTEMC) $(LIB_ARCHC) $(LIB_POWERSC) $(LIB_DWARF) -lm $(EXTRA_LIBS)\n");
+  fprintf( output, "LIBS := $(LIB_SYSTEMC) $(LIB_ARCHC) $(LIB_POWERSC) $(LIB_DWARF) -lm -lpthread%s $(EXTRA_LIBS)\n",
+           (ACVerboseFlag) ? " -lrt" : "" );
   fprintf( output, "CC :=  %s", CC_PATH);
   fprintf( output, "OPT :=  %s", OPT_FLAGS);
   fprintf( output, "DEBUG :=  %s", DEBUG_FLAGS);
@@ -3315,7 +3681,9 @@ void CreateMakefile(){
   COMMENT_MAKE("These are the library files provided by ArchC");
   COMMENT_MAKE("They are stored in the archc/lib directory");
 
-  fprintf(output, "ACLIBFILES := ac_decoder_rt.o ac_module.o ac_storage.o ac_utils.o "HLT_OBJ" ");
+  fprintf(output, "ACLIBFILES := ac_decoder_rt.o ac_module.o ac_storage.o ac_utils.o ac_checkpoint.o ac_sampling.o ac_instr_trace.o ac_chunk_writer.o "HLT_OBJ" ");
+  if(ACProfileFlag)
+      fprintf(output, "ac_profiler.o ");
   if(ACABIFlag)
       fprintf(output, "ac_syscall.o ");
   if(HaveTLMPorts)
@@ -3472,16 +3840,38 @@ void EmitUpdateMethod( FILE *output, int base_indent ) {
   }
   
   if( ACDelayFlag ){
+    int bit = 0;
+
     fprintf( output, "%sif(!ac_wait_sig){\n", INDENT[base_indent]);
+    //Storage devices whose delays are not tracked in ac_delay_mask
     for( pstorage = storage_list; pstorage!= NULL; pstorage = pstorage->next ) {
-        if (pstorage->has_memport)
-            fprintf( output, "%s%s_mport.commit_delays( (double)ac_cycle_counter );\n", INDENT[base_indent + 1], pstorage->name);
-        else
-            fprintf( output, "%s%s.commit_delays( (double)ac_cycle_counter );\n", INDENT[base_indent + 1], pstorage->name);
+      int queues = DelayQueues(pstorage);
+
+      if (!queues || (bit + queues > 64))
+        fprintf( output, "%s%s%s.commit_delays( (double)ac_cycle_counter );\n", INDENT[base_indent + 1],
+                 pstorage->name, pstorage->has_memport ? "_mport" : "");
+      bit += queues;
     }
-      
-    fprintf( output, "%sac_pc.commit_delays(  (double)ac_cycle_counter );\n", 
-             INDENT[base_indent + 1]);
+
+    //Only the devices with delayed writes pending
+    bit = 0;
+    fprintf( output, "%sif (ac_delay_mask) {\n", INDENT[base_indent + 1]);
+    for( pstorage = storage_list; pstorage!= NULL; pstorage = pstorage->next ) {
+      int queues = DelayQueues(pstorage);
+
+      if (queues && (bit + queues <= 64))
+        fprintf( output, "%sif (ac_delay_mask & 0x%llxULL) %s%s.commit_delays( (double)ac_cycle_counter );\n",
+                 INDENT[base_indent + 2], (~0ULL >> (64 - queues)) << bit,
+                 pstorage->name, pstorage->has_memport ? "_mport" : "");
+      bit += queues;
+    }
+    if (bit < 64)
+      fprintf( output, "%sif (ac_delay_mask & 0x%llxULL) ac_pc.commit_delays( (double)ac_cycle_counter );\n", 
+               INDENT[base_indent + 2], 1ULL << bit);
+    fprintf( output, "%s}\n", INDENT[base_indent + 1]);
+    if (bit >= 64)
+      fprintf( output, "%sac_pc.commit_delays( (double)ac_cycle_counter );\n", 
+               INDENT[base_indent + 1]);
     fprintf( output, "%sif(!ac_parallel_sig)\n", INDENT[base_indent + 1]);
     fprintf( output, "%sac_cycle_counter++;\n", INDENT[base_indent + 2]);
     fprintf( output, "%selse\n", INDENT[base_indent + 1]);
@@ -3500,9 +3890,53 @@ void EmitUpdateMethod( FILE *output, int base_indent ) {
   
   if (ACWaitFlag) {
     fprintf(output, "%sif (ac_qk.need_sync()) {\n", INDENT[base_indent]);
-    fprintf(output, "%sac_qk.sync();\n", INDENT[base_indent + 1]);
+    fprintf(output, "%shost_sync();\n", INDENT[base_indent + 1]);
     fprintf(output, "%s}\n", INDENT[base_indent]);
   }
+
+  if (ACCheckpointFlag)
+    fprintf(output, "%sif (ac_instr_counter >= ac_checkpoint_at) take_checkpoint();\n", 
+            INDENT[base_indent]);
+  if (ACSamplingFlag)
+    fprintf(output, "%sif (ac_instr_counter >= ac_sample_at) sample_phase();\n", 
+            INDENT[base_indent]);
+  if (ACGDBTraps)
+    fprintf(output, "%sif (ac_instr_counter >= ac_trap_at) gdb_step();\n", 
+            INDENT[base_indent]);
+  if (ACCosimFlag)
+    fprintf(output, "%sif (ac_instr_counter >= ac_pause_at) cosim->pause(*this);\n", 
+            INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Returns the number of delayed write queues of a storage
+  device tracked in ac_delay_mask: one per field of a formatted
+  register, one for other registers, register banks and memory
+  ports, none for the other devices.
+  \brief Used by EmitUpdateMethod and CreateArchImpl functions */
+/***************************************/
+int DelayQueues( ac_sto_list *pstorage ) {
+  extern ac_dec_format *format_reg_list;
+  ac_dec_format *pformat;
+  ac_dec_field *pfield;
+  int queues = 0;
+
+  if (pstorage->has_memport || (pstorage->type == REGBANK))
+    return 1;
+  if (pstorage->type != REG)
+    return 0;
+  if (pstorage->format == NULL)
+    return 1;
+
+  for (pformat = format_reg_list; pformat != NULL; pformat = pformat->next)
+    if (!strcmp(pformat->name, pstorage->format))
+      break;
+  if (pformat == NULL)
+    return 0;
+  for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+    queues++;
+  return queues;
 }
 
 
@@ -3544,7 +3978,7 @@ void EmitDecodification( FILE *output, int base_indent) {
   //}
 
   if( ACDecCacheFlag ){
-    fprintf( output, "%sinstr_dec = (DEC_CACHE + (", INDENT[base_indent]);
+    fprintf( output, "%sinstr_dec = dec_cache_at(", INDENT[base_indent]);
     if (ACFullDecode)
       fprintf( output, "decode_pc");
     else
@@ -3552,7 +3986,7 @@ void EmitDecodification( FILE *output, int base_indent) {
     
     if( ACIndexFix ) 
       fprintf( output, " / %d", largest_format_size / 8);
-    fprintf( output, "));\n");
+    fprintf( output, ");\n");
     
     if( !ACFullDecode ) {
       fprintf( output, "%sif ( !instr_dec->valid ){\n", INDENT[base_indent]);
@@ -3566,7 +4000,7 @@ void EmitDecodification( FILE *output, int base_indent) {
     fprintf( output, "%sdecode_pc = ac_pc;\n", INDENT[base_indent]);
   
   fprintf( output, "%squant = 0;\n", INDENT[base_indent]);
-  fprintf( output, "%sins_cache = (ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(buffer), quant);\n", 
+  fprintf( output, "%sins_cache = (ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(buffer), quant, dec_fields);\n", 
            INDENT[base_indent]);
   
   if( ACDecCacheFlag ){
@@ -3575,16 +4009,35 @@ void EmitDecodification( FILE *output, int base_indent) {
                INDENT[base_indent]);
       base_indent++;
     }
-    else
+    else {
       fprintf( output, "%sinstr_dec->valid = true;\n", 
                INDENT[base_indent]);
+      fprintf( output, "%smark_code_page(decode_pc);\n", INDENT[base_indent]);
+      fprintf( output, "%smark_code_page(decode_pc + %d);\n", 
+               INDENT[base_indent], largest_format_size / 8 - 1);
+    }
       
     fprintf( output, "%sinstr_dec->id = ins_cache ? ins_cache[IDENT]: 0;\n", 
              INDENT[base_indent]);
     
     if (ACThreading)
-      fprintf( output, "%sinstr_dec->end_rot = IntRoutine[instr_dec->id];\n", 
+      fprintf( output, "%sinstr_dec->end_rot = IntRoutine[instr_dec->id];\n",
+               INDENT[base_indent]);
+
+    if (ACBlockChaining)
+      fprintf( output, "%sinstr_dec->succ = instr_dec->exit = NULL;\n",
                INDENT[base_indent]);
+
+    if (ACGDBTraps) {
+      fprintf( output, "%sif (!gdb_traps.empty()) {\n", INDENT[base_indent]);
+      fprintf( output, "%sstd::map<unsigned, void*>::iterator trap = gdb_traps.find(decode_pc);\n", 
+               INDENT[base_indent + 1]);
+      fprintf( output, "%sif (trap != gdb_traps.end()) {\n", INDENT[base_indent + 1]);
+      fprintf( output, "%strap->second = instr_dec->end_rot;\n", INDENT[base_indent + 2]);
+      fprintf( output, "%sinstr_dec->end_rot = TrapRoutine;\n", INDENT[base_indent + 2]);
+      fprintf( output, "%s}\n", INDENT[base_indent + 1]);
+      fprintf( output, "%s}\n", INDENT[base_indent]);
+    }
     
     EmitDecCacheAt( output, base_indent);
     
@@ -3625,7 +4078,7 @@ void EmitInstrExecIni( FILE *output, int base_indent) {
   ac_dec_format *pformat;
   ac_dec_field *pfield;
   
-  if( ACGDBIntegrationFlag )
+  if( ACGDBIntegrationFlag && !ACGDBTraps )
     fprintf( output, "%sif (gdbstub && gdbstub->stop(ac_pc)) gdbstub->process_bp();\n\n", 
              INDENT[base_indent]);
 
@@ -3673,6 +4126,11 @@ void EmitInstrExec( FILE *output, int base_indent){
         fprintf(output, "%sI_Init:\n", INDENT[base_indent]);
         fprintf(output, "%sgoto *dispatch();\n\n", INDENT[base_indent + 1]);
 
+        if ( ACGDBTraps ) {
+            fprintf(output, "%sI_Trap: // GDB breakpoint\n", INDENT[base_indent]);
+            fprintf(output, "%sgoto *gdb_trap();\n\n", INDENT[base_indent + 1]);
+        }
+
         if ( ACABIFlag && ACDecCacheFlag ) {
             fprintf( output, "%s#define AC_SYSC(NAME,LOCATION) \\\n", 
                     INDENT[base_indent]);
@@ -3680,8 +4138,9 @@ void EmitInstrExec( FILE *output, int base_indent){
             base_indent++;
 
             if( ACStatsFlag ){
-                fprintf( output, "%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
-                        INDENT[base_indent], project_name);
+                fprintf( output, "%s%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
+                        INDENT[base_indent], ACSamplingFlag ? "if (sampler.detailed()) " : "",
+                        project_name);
             }
 
             fprintf( output, "%sISA.syscall.NAME(); \\\n", INDENT[base_indent]);
@@ -3696,7 +4155,7 @@ void EmitInstrExec( FILE *output, int base_indent){
 
         if( ACDebugFlag ){
             fprintf( output, "%sif( ac_do_trace != 0 ) \n", INDENT[base_indent]);
-            fprintf( output, PRINT_TRACE, INDENT[base_indent+1]);
+            fprintf( output, PRINT_TRACE, INDENT[base_indent+1], INDENT[base_indent+1]);
             fprintf( output, "\n");
         }
         if( ACHLTraceFlag)
@@ -3780,7 +4239,9 @@ void EmitInstrExec( FILE *output, int base_indent){
             fprintf(output, "%sac_qk.inc(sc_time(module_period_ns*%d, SC_NS));\n", INDENT[base_indent + 1], pinstr->cycles);
         }
 
-        if( ACThreading )
+        if( ACBlockChaining )
+            fprintf(output, "%sgoto *chain();\n\n", INDENT[base_indent + 1]);
+        else if( ACThreading )
             fprintf(output, "%sgoto *dispatch();\n\n", INDENT[base_indent + 1]);
         else
             fprintf(output, "%sbreak;\n", INDENT[base_indent]);
@@ -3790,7 +4251,8 @@ void EmitInstrExec( FILE *output, int base_indent){
         fprintf(output, "%s} // switch (ins_id)\n", INDENT[base_indent]);
 
         if( ACStatsFlag ){
-            fprintf( output, "%sif(!ac_wait_sig) {\n", INDENT[base_indent]);
+            fprintf( output, "%sif(!ac_wait_sig%s) {\n", INDENT[base_indent],
+                     ACSamplingFlag ? " && sampler.detailed()" : "");
             fprintf( output, "%sISA.stats[%s_stat_ids::INSTRUCTIONS]++;\n", 
                     INDENT[base_indent+1], project_name);
             fprintf( output, "%s(*(ISA.instr_stats[ins_id]))[%s_instr_stat_ids::COUNT]++;\n", 
@@ -3841,6 +4303,10 @@ void EmitProcessorBhv( FILE *output, int base_indent ) {
   base_indent++;
   
   EmitFetchInit(output, base_indent);
+
+  if( ACProfileFlag )
+    fprintf( output, "%sif (ac_pc != profile_pc) profiler.enter(ac_pc, ac_instr_counter);\n", 
+             INDENT[base_indent]);
   
   if( ACABIFlag ) {  
     if (ACSyscallJump) {
@@ -3859,13 +4325,14 @@ void EmitProcessorBhv( FILE *output, int base_indent ) {
     base_indent++;
     
     if( ACStatsFlag ){
-      fprintf( output, "%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
-              INDENT[base_indent], project_name);
+      fprintf( output, "%s%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
+              INDENT[base_indent], ACSamplingFlag ? "if (sampler.detailed()) " : "",
+              project_name);
     }
 
     if( ACDebugFlag ){
       fprintf( output, "%sif( ac_do_trace != 0 )\\\n", INDENT[base_indent]);
-      fprintf( output, "%strace_file << hex << ac_pc << dec << endl; \\\n", 
+      fprintf( output, "%sif (ac_bin_trace) ac_bin_trace->add(ac_pc, 0); else trace_file << hex << ac_pc << dec << endl; \\\n", 
               INDENT[base_indent + 1]);
     }
 
@@ -3900,14 +4367,18 @@ void EmitProcessorBhv( FILE *output, int base_indent ) {
   }
   
   if( ACFullDecode ) {
-    fprintf( output, "%sinstr_dec = (DEC_CACHE + (ac_pc", 
+    fprintf( output, "%sinstr_dec = dec_cache_at(ac_pc", 
              INDENT[base_indent]);
     if( ACIndexFix ) 
       fprintf( output, " / %d", largest_format_size / 8);
-    fprintf( output, "));\n");
+    fprintf( output, ");\n");
     fprintf( output, "%sins_id = instr_dec->id;\n\n", INDENT[base_indent]);
   }
   else EmitDecodification(output, base_indent);
+
+  if( ACProfileFlag )
+    fprintf( output, "%sprofile_pc = ac_pc + ISA.instr_table[ins_id].ac_instr_size;\n", 
+             INDENT[base_indent]);
     
   EmitInstrExec(output, base_indent);
 
@@ -3940,6 +4411,438 @@ void EmitProcessorBhv( FILE *output, int base_indent ) {
 }
 
 
+/**************************************/
+/*!  Emits the calls saving or restoring the storage
+  devices of the model to a checkpoint.
+  \brief Used by EmitCheckpoint function      */
+/***************************************/
+static void EmitCheckpointStorages( FILE *output, int base_indent, int restore ) {
+  extern ac_sto_list *storage_list;
+  extern int HaveMemHier, HaveTLMIntrPorts, HaveTLM2IntrPorts;
+  ac_sto_list *pstorage;
+  const char *prefix = restore ? "ok &= " : "";
+  const char *method = restore ? "restore" : "save";
+
+  fprintf(output, "%s%sac_pc.%s(ckpt, \"ac_pc\");\n", INDENT[base_indent], prefix, method);
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next) {
+    switch (pstorage->type) {
+      case CACHE:
+      case ICACHE:
+      case DCACHE:
+      case MEM:
+        // ac_cache and ac_mem objects are not saved
+        if (HaveMemHier)
+          break;
+      case REG:
+      case REGBANK:
+      default:
+        fprintf(output, "%s%s%s.%s(ckpt, \"%s\");\n", INDENT[base_indent], prefix,
+                pstorage->name, method, pstorage->name);
+        break;
+
+      case TLM_PORT:
+      case TLM2_PORT:
+      case TLM2_NB_PORT:
+        // Devices behind ports belong to the platform
+        break;
+    }
+  }
+
+  if (HaveTLMIntrPorts || HaveTLM2IntrPorts)
+    fprintf(output, "%s%sintr_reg.%s(ckpt, \"intr_reg\");\n", INDENT[base_indent], prefix, method);
+
+  fprintf(output, "%s%sac_dyn_loader.mem_map.%s(ckpt, \"mem_map\");\n", 
+          INDENT[base_indent], prefix, method);
+}
+
+
+/**************************************/
+/*!  Emits the checkpoint methods of the processor:
+  save_checkpoint(), restore_checkpoint(), take_checkpoint()
+  (called when ac_instr_counter reaches ac_checkpoint_at) and
+  RequestCheckpoint() (called by the checkpoint signal handler).
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitCheckpoint( FILE *output, int base_indent ) {
+  extern char* project_name;
+  extern int HaveMemHier;
+
+  /* save_checkpoint() */
+  fprintf(output, "%s// Saves the architectural state to a checkpoint file\n", INDENT[base_indent]);
+  fprintf(output, "%sbool %s::save_checkpoint(const char* file) {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sac_checkpoint_writer ckpt(file);\n\n", INDENT[base_indent + 1]);
+  if (HaveMemHier)
+    fprintf(output, "%sAC_WARN(\"checkpoint: the memory hierarchy is not saved\");\n", 
+            INDENT[base_indent + 1]);
+  fprintf(output, "%sckpt.save(\"ac_instr_counter\", ac_instr_counter);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sckpt.save(\"ac_cycle_counter\", ac_cycle_counter);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sckpt.save(\"ac_heap_ptr\", ac_heap_ptr);\n", INDENT[base_indent + 1]);
+  EmitCheckpointStorages(output, base_indent + 1, 0);
+  fprintf(output, "%sckpt.save_files();\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sreturn ckpt.close();\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+
+  /* restore_checkpoint() */
+  fprintf(output, "%s// Restores the architectural state from a checkpoint file\n", INDENT[base_indent]);
+  fprintf(output, "%sbool %s::restore_checkpoint(const char* file) {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sac_checkpoint_reader ckpt(file);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sbool ok = true;\n\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sif (!ckpt.good())\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sreturn false;\n\n", INDENT[base_indent + 2]);
+  fprintf(output, "%sok &= ckpt.restore(\"ac_instr_counter\", ac_instr_counter);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sok &= ckpt.restore(\"ac_cycle_counter\", ac_cycle_counter);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sok &= ckpt.restore(\"ac_heap_ptr\", ac_heap_ptr);\n", INDENT[base_indent + 1]);
+  EmitCheckpointStorages(output, base_indent + 1, 1);
+  fprintf(output, "%sok &= ckpt.restore_files();\n", INDENT[base_indent + 1]);
+  if (ACDecCacheFlag && !ACFullDecode) {
+    fprintf(output, "\n");
+    COMMENT(INDENT[base_indent + 1], "Drops the instructions decoded from the previous contents.");
+    fprintf(output, "%sif (code_page_map)\n", INDENT[base_indent + 1]);
+    fprintf(output, "%sfor (unsigned page = 0; page < code_page_count; page++)\n", INDENT[base_indent + 2]);
+    fprintf(output, "%sif (code_page_map[page])\n", INDENT[base_indent + 3]);
+    fprintf(output, "%sinvalidate_code_page(page);\n", INDENT[base_indent + 4]);
+  }
+  fprintf(output, "%sreturn ok;\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+
+  /* take_checkpoint() */
+  fprintf(output, "%s// Saves the checkpoint requested by --checkpoint-at or by a signal\n", INDENT[base_indent]);
+  fprintf(output, "%svoid %s::take_checkpoint() {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sconst char* file = ac_checkpoint_path.empty() ? \"%s.ckpt\" : ac_checkpoint_path.c_str();\n\n", 
+          INDENT[base_indent + 1], project_name);
+  fprintf(output, "%sac_checkpoint_at = ~0ULL;\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sif (save_checkpoint(file))\n", INDENT[base_indent + 1]);
+  fprintf(output, "%scerr << \"ArchC: Checkpoint saved to \" << file << \" after \" << ac_instr_counter << \" instructions\" << endl;\n", 
+          INDENT[base_indent + 2]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+
+  /* RequestCheckpoint() */
+  fprintf(output, "%s// Takes a checkpoint at the next instruction boundary\n", INDENT[base_indent]);
+  fprintf(output, "%svoid %s::RequestCheckpoint() {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sac_checkpoint_at = 0;\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits the part of init() that restores the --restore
+  checkpoint and schedules the --checkpoint-at one. Simulators
+  generated without --checkpoint refuse these options instead of
+  silently running from the start.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitCheckpointInit( FILE *output, int base_indent ) {
+
+  if (!ACCheckpointFlag) {
+    fprintf(output, "%sif (!ac_restore_path.empty() || !ac_checkpoint_path.empty() || (ac_checkpoint_count != ~0ULL)) {\n",
+            INDENT[base_indent]);
+    fprintf(output, "%sAC_ERROR(\"checkpoints are not supported by this simulator (generate it with acsim --checkpoint)\");\n",
+            INDENT[base_indent + 1]);
+    fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[base_indent + 1]);
+    fprintf(output, "%s}\n", INDENT[base_indent]);
+    return;
+  }
+
+  fprintf(output, "%sif (!ac_restore_path.empty() && !restore_checkpoint(ac_restore_path.c_str())) {\n", INDENT[base_indent]);
+  fprintf(output, "%sAC_ERROR(\"could not restore checkpoint \" << ac_restore_path);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n", INDENT[base_indent]);
+  fprintf(output, "%sac_checkpoint_at = ac_checkpoint_count;\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits cosim_state(), listing the registers the
+  co-simulation harness (ac_cosim) compares: ac_pc, the
+  registers but the processor id (formatted ones field by field),
+  the register banks and the interrupt register.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitCosimState( FILE *output, int base_indent ) {
+  extern ac_sto_list *storage_list;
+  extern ac_dec_format *format_reg_list;
+  extern char* project_name;
+  extern int HaveTLMIntrPorts, HaveTLM2IntrPorts;
+  ac_sto_list *pstorage;
+  ac_dec_format *pformat;
+  ac_dec_field *pfield;
+
+  fprintf(output, "%s// Lists the registers compared by the co-simulation\n", INDENT[base_indent]);
+  fprintf(output, "%svoid %s::cosim_state(ac_cosim_state& state) {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sstate.add(\"ac_pc\", ac_pc.read());\n", INDENT[base_indent + 1]);
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next) {
+    switch (pstorage->type) {
+      case REG:
+        //The processor id tells the two models apart
+        if (!strcmp(pstorage->name, "id"))
+          break;
+        if (pstorage->format == NULL) {
+          fprintf(output, "%sstate.add(\"%s\", %s.read());\n", INDENT[base_indent + 1],
+                  pstorage->name, pstorage->name);
+          break;
+        }
+
+        //Formatted registers are compared field by field
+        for (pformat = format_reg_list; pformat != NULL; pformat = pformat->next)
+          if (!strcmp(pformat->name, pstorage->format))
+            break;
+        for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+          fprintf(output, "%sstate.add(\"%s.%s\", %s.%s.read());\n", INDENT[base_indent + 1],
+                  pstorage->name, pfield->name, pstorage->name, pfield->name);
+        break;
+
+      case REGBANK:
+        fprintf(output, "%sstate.add(\"%s\", %s.Data, sizeof(%s.Data), sizeof(%s.Data[0]));\n", 
+                INDENT[base_indent + 1], pstorage->name, pstorage->name, pstorage->name,
+                pstorage->name);
+        break;
+
+      default:
+        // Memories are compared through DATA_PORT
+        break;
+    }
+  }
+
+  if (HaveTLMIntrPorts || HaveTLM2IntrPorts)
+    fprintf(output, "%sstate.add(\"intr_reg\", intr_reg.read());\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits target_description(), the GDB target.xml listing the
+  register banks in declaration order, then the registers, then
+  ac_pc, all ac_word sized as in the 'g' packet. It is only served
+  when nRegs() counts the same registers, so models whose gdb_funcs
+  follow an architecture specific layout keep GDB's own.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitGDBTargetDescription( FILE *output, int base_indent ) {
+  extern ac_sto_list *storage_list;
+  extern char* project_name;
+  extern int wordsize;
+  ac_sto_list *pstorage;
+  int regnum = 0;
+  unsigned i;
+
+  fprintf(output, "%s// GDB target description, see the GDB doc \"Target Descriptions\"\n", INDENT[base_indent]);
+  fprintf(output, "%sconst char* %s::target_description() {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sstatic const char xml[] =\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s\"<?xml version=\\\"1.0\\\"?>\\n\"\n", INDENT[base_indent + 2]);
+  fprintf(output, "%s\"<!DOCTYPE target SYSTEM \\\"gdb-target.dtd\\\">\\n\"\n", INDENT[base_indent + 2]);
+  fprintf(output, "%s\"<target version=\\\"1.0\\\">\\n\"\n", INDENT[base_indent + 2]);
+  fprintf(output, "%s\"<feature name=\\\"org.archc.%s\\\">\\n\"\n", INDENT[base_indent + 2], project_name);
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next)
+    if (pstorage->type == REGBANK)
+      for (i = 0; i < pstorage->size; i++, regnum++)
+        fprintf(output, "%s\"<reg name=\\\"%s%u\\\" bitsize=\\\"%d\\\" regnum=\\\"%d\\\"/>\\n\"\n",
+                INDENT[base_indent + 2], pstorage->name, i, wordsize, regnum);
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next)
+    if (pstorage->type == REG)
+      fprintf(output, "%s\"<reg name=\\\"%s\\\" bitsize=\\\"%d\\\" regnum=\\\"%d\\\"/>\\n\"\n",
+              INDENT[base_indent + 2], pstorage->name, wordsize, regnum++);
+
+  fprintf(output, "%s\"<reg name=\\\"pc\\\" bitsize=\\\"%d\\\" regnum=\\\"%d\\\" type=\\\"code_ptr\\\"/>\\n\"\n",
+          INDENT[base_indent + 2], wordsize, regnum++);
+  fprintf(output, "%s\"</feature>\\n\"\n", INDENT[base_indent + 2]);
+  fprintf(output, "%s\"</target>\\n\";\n\n", INDENT[base_indent + 2]);
+  fprintf(output, "%sreturn (nRegs() == %d) ? xml : NULL;\n", INDENT[base_indent + 1], regnum);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits a statement for every cache of the memory hierarchy,
+  with %s standing for the cache name.
+  \brief Used by EmitSampling function      */
+/***************************************/
+static void EmitSamplingCaches( FILE *output, int indent, const char* statement ) {
+  extern ac_sto_list *storage_list;
+  extern int HaveMemHier;
+  ac_sto_list *pstorage;
+
+  if (!HaveMemHier)
+    return;
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next) {
+    switch(pstorage->type) {
+      case CACHE:
+      case ICACHE:
+      case DCACHE:
+        fprintf(output, "%s", INDENT[indent]);
+        fprintf(output, statement, pstorage->name);
+        fprintf(output, "\n");
+        break;
+      default:
+        continue;
+    }
+  }
+}
+
+
+/**************************************/
+/*!  Emits sample_phase(), called when ac_instr_counter reaches
+  ac_sample_at during a sampled simulation (--sample). It reports
+  the sample just measured and sets up the next phase: caches
+  bypassed while fast-forwarding, caches modeled from the warm-up
+  on, statistics cleared when the measurement starts.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitSampling( FILE *output, int base_indent ) {
+  extern char* project_name;
+
+  fprintf(output, "%s// Moves the sampled simulation to its next phase\n", INDENT[base_indent]);
+  fprintf(output, "%svoid %s::sample_phase() {\n", INDENT[base_indent], project_name);
+  fprintf(output, "%sif (sampler.get_phase() == ac_sampler::MEASURE) {\n", INDENT[base_indent + 1]);
+  fprintf(output, "%scerr << \"ArchC: Sample \" << sampler.get_sample() << \"/\" << sampler.get_sample_count()\n", 
+          INDENT[base_indent + 2]);
+  fprintf(output, "%s<< \" (instructions \" << sampler.get_measure_start() << \"-\" << ac_instr_counter\n", 
+          INDENT[base_indent + 3]);
+  fprintf(output, "%s<< \", weight \" << sampler.get_weight() << \")\" << endl;\n", INDENT[base_indent + 3]);
+  if (ACStatsFlag)
+    fprintf(output, "%sISA.stats.print_stats(cerr);\n", INDENT[base_indent + 2]);
+  EmitSamplingCaches(output, base_indent + 2, "cerr << \"cache: %s\" << endl;");
+  EmitSamplingCaches(output, base_indent + 2, "%s.print_statistics(cerr);");
+  fprintf(output, "%s}\n\n", INDENT[base_indent + 1]);
+
+  fprintf(output, "%sswitch (sampler.advance(ac_instr_counter)) {\n", INDENT[base_indent + 1]);
+  fprintf(output, "%scase ac_sampler::FAST_FORWARD:\n", INDENT[base_indent + 2]);
+  EmitSamplingCaches(output, base_indent + 3, "%s.set_functional(true);");
+  fprintf(output, "%sbreak;\n", INDENT[base_indent + 3]);
+  fprintf(output, "%scase ac_sampler::WARM_UP:\n", INDENT[base_indent + 2]);
+  EmitSamplingCaches(output, base_indent + 3, "%s.set_functional(false);");
+  fprintf(output, "%sbreak;\n", INDENT[base_indent + 3]);
+  fprintf(output, "%scase ac_sampler::MEASURE:\n", INDENT[base_indent + 2]);
+  EmitSamplingCaches(output, base_indent + 3, "%s.set_functional(false);");
+  EmitSamplingCaches(output, base_indent + 3, "%s.reset_statistics();");
+  if (ACStatsFlag)
+    fprintf(output, "%sISA.stats.reset_stats();\n", INDENT[base_indent + 3]);
+  fprintf(output, "%sbreak;\n", INDENT[base_indent + 3]);
+  fprintf(output, "%sdefault:\n", INDENT[base_indent + 2]);
+  fprintf(output, "%sac_sample_at = ~0ULL;\n", INDENT[base_indent + 3]);
+  fprintf(output, "%sstop();\n", INDENT[base_indent + 3]);
+  fprintf(output, "%sreturn;\n", INDENT[base_indent + 3]);
+  fprintf(output, "%s}\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sac_sample_at = sampler.next_change();\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits the part of init() that loads the --sample file and
+  enters the first phase. Simulators generated without
+  --sampling refuse the option instead of silently running the
+  whole program in detail.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitSamplingInit( FILE *output, int base_indent ) {
+
+  if (!ACSamplingFlag) {
+    fprintf(output, "%sif (!ac_sample_path.empty()) {\n", INDENT[base_indent]);
+    fprintf(output, "%sAC_ERROR(\"sampled simulation is not supported by this simulator (generate it with acsim --sampling)\");\n",
+            INDENT[base_indent + 1]);
+    fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[base_indent + 1]);
+    fprintf(output, "%s}\n", INDENT[base_indent]);
+    return;
+  }
+
+  fprintf(output, "%sif (!ac_sample_path.empty()) {\n", INDENT[base_indent]);
+  fprintf(output, "%sif (!sampler.load(ac_sample_path.c_str(), ac_sample_warm_up, ac_sample_length))\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sexit(EXIT_FAILURE);\n", INDENT[base_indent + 2]);
+  fprintf(output, "%ssample_phase();\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n", INDENT[base_indent]);
+}
+
+
+/**************************************/
+/*!  Emits, for the storage devices checked by acverifier
+  (register banks and the memories and caches accessed through
+  a memport), either their listing in the co-verification link
+  or the sending of their update logs. Devices are numbered in
+  storage list order in both cases.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitVerifyStorages( FILE *output, int base_indent, int open ) {
+  extern ac_sto_list *storage_list;
+  extern int HaveMemHier;
+  ac_sto_list *pstorage;
+  const char *suffix;
+  int device = 0;
+
+  for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next) {
+    switch (pstorage->type) {
+      case REGBANK:
+        suffix = "";
+        break;
+
+      case CACHE:
+      case ICACHE:
+      case DCACHE:
+        if (HaveMemHier && pstorage->level != 0)
+          continue;
+        suffix = "_mport";
+        break;
+
+      case MEM:
+        if (HaveMemHier)
+          continue;
+        suffix = "_mport";
+        break;
+
+      default:
+        continue;
+    }
+
+    if (open)
+      fprintf(output, "%sac_verify_link.add_device(\"%s\");\n", INDENT[base_indent], pstorage->name);
+    else
+      fprintf(output, "%sac_verify_link.send(%d, *%s%s.get_changes());\n",
+              INDENT[base_indent], device, pstorage->name, suffix);
+    device++;
+  }
+}
+
+
+/**************************************/
+/*!  Emits profile_decode(), which gives the basic block
+  profiler the instructions of a block from the decoder cache
+  to build the instruction mix of its report.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitProfileDecode( FILE *output, int base_indent ) {
+  extern char* project_name;
+  extern int largest_format_size;
+
+  fprintf(output, "%s// Gives the id of the instruction decoded at pc\n", INDENT[base_indent]);
+  fprintf(output, "%sbool %s::profile_decode(void* context, unsigned pc, unsigned& id) {\n", 
+          INDENT[base_indent], project_name);
+  fprintf(output, "%s%s* self = (%s*) context;\n", INDENT[base_indent + 1], project_name, project_name);
+  fprintf(output, "%sunsigned index = pc", INDENT[base_indent + 1]);
+  if (ACIndexFix)
+    fprintf(output, " / %d", largest_format_size / 8);
+  fprintf(output, ";\n\n");
+  fprintf(output, "%sif (pc >= self->dec_cache_size)\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sreturn false;\n", INDENT[base_indent + 2]);
+  fprintf(output, "%sDecCacheItem* items = self->DEC_CACHE[index >> %s_parms::AC_DEC_CACHE_PAGE_BITS];\n", 
+          INDENT[base_indent + 1], project_name);
+  fprintf(output, "%sif (!items)\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sreturn false;\n", INDENT[base_indent + 2]);
+  fprintf(output, "%sDecCacheItem* item = items + (index & ((1U << %s_parms::AC_DEC_CACHE_PAGE_BITS) - 1));\n", 
+          INDENT[base_indent + 1], project_name);
+  if (!ACFullDecode) {
+    fprintf(output, "%sif (!item->valid)\n", INDENT[base_indent + 1]);
+    fprintf(output, "%sreturn false;\n", INDENT[base_indent + 2]);
+  }
+  fprintf(output, "%sid = item->id;\n", INDENT[base_indent + 1]);
+  fprintf(output, "%sreturn id != 0;\n", INDENT[base_indent + 1]);
+  fprintf(output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
 /**************************************/
 /*!  Emits a ac_cache instantiation.
   \brief Used by CreateResourcesImpl function      */
@@ -4166,13 +5069,22 @@ void EmitDecCache(FILE *output, int base_indent) {
     fprintf(output, "%s} T_%s;\n\n", INDENT[base_indent], pformat->name);
   }
   
-  fprintf(output, "%stypedef struct {\n", INDENT[base_indent]);
-  if( !ACFullDecode ) 
+  fprintf(output, "%stypedef struct DecCacheItem {\n", INDENT[base_indent]);
+  if( !ACFullDecode )
     fprintf(output, "%sbool valid;\n", INDENT[base_indent + 1]);
   if (ACThreading)
     fprintf(output, "%svoid* end_rot;\n", INDENT[base_indent + 1]);
   fprintf(output, "%sunsigned id;\n", INDENT[base_indent + 1]);
-  
+
+  //Block links, set by dispatch() and followed by chain()
+  if (ACBlockChaining) {
+    fprintf(output, "%sstruct DecCacheItem* succ;\t//!< Next instruction of the block, once linked.\n",
+            INDENT[base_indent + 1]);
+    fprintf(output, "%sstruct DecCacheItem* exit;\t//!< First instruction of the block taken at exit_pc.\n",
+            INDENT[base_indent + 1]);
+    fprintf(output, "%sunsigned exit_pc;\n", INDENT[base_indent + 1]);
+  }
+
   fprintf(output, "%sunion {\n", INDENT[base_indent + 1]);
   for (pformat = format_ins_list; pformat != NULL ; pformat = pformat->next) {
     fprintf(output, "%sT_%s F_%s;\n", INDENT[base_indent + 2], 
@@ -4242,7 +5154,7 @@ void EmitDispatch(FILE *output, int base_indent) {
     fprintf(output, "%s/* wake - this event will happen in the moment the processor receives and            */\n",INDENT[base_indent]);
     fprintf(output, "%s/* interrupt with code AWAKE (1)                                                     */\n",INDENT[base_indent]);    
     fprintf(output, "%s/*************************************************************************************/\n",INDENT[base_indent]);
-    fprintf(output, "%sif (intr_reg.read() == 0)  wait(wake);\n",INDENT[base_indent]);  
+    fprintf(output, "%sif (intr_reg.read() == 0)  host_wait(wake);\n",INDENT[base_indent]);  
   }
 
 
@@ -4251,11 +5163,50 @@ void EmitDispatch(FILE *output, int base_indent) {
     fprintf( output, "%sextern ofstream trace_file;\n", INDENT[base_indent]);
   }
   
+  //A new block starts here. The update method may shorten it (GDB steps).
+  if( ACBlockChaining )
+    fprintf( output, "%schain_left = %s_parms::AC_MAX_BLOCK_SIZE;\n", 
+             INDENT[base_indent], project_name);
+
   //!Emit update method.
   EmitUpdateMethod( output, base_indent);
+
+  //The block ends where the co-simulation pauses, a checkpoint is due
+  //or the sampled simulation changes phase.
+  if( ACBlockChaining ) {
+    if( ACCosimFlag )
+      fprintf( output, "%sif (ac_pause_at - ac_instr_counter < chain_left) chain_left = ac_pause_at - ac_instr_counter;\n", 
+               INDENT[base_indent]);
+    if( ACCheckpointFlag )
+      fprintf( output, "%sif (ac_checkpoint_at - ac_instr_counter < chain_left) chain_left = ac_checkpoint_at - ac_instr_counter;\n", 
+               INDENT[base_indent]);
+    if( ACSamplingFlag )
+      fprintf( output, "%sif (ac_sample_at - ac_instr_counter < chain_left) chain_left = ac_sample_at - ac_instr_counter;\n", 
+               INDENT[base_indent]);
+  }
   
   EmitFetchInit(output, base_indent);
-  
+
+  if( ACProfileFlag )
+    fprintf( output, "%sif (ac_pc != %s) profiler.enter(ac_pc, ac_instr_counter);\n", 
+             INDENT[base_indent], ACBlockChaining ? "chain_pc" : "profile_pc");
+
+  EmitDispatchBody(output, base_indent, 0);
+
+  base_indent--;
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);  
+}
+
+
+/**************************************/
+/*!  Emits the per-instruction part of the Dispatch Function:
+  decodification, statistics, traces and the jump target.
+  When linked is set, instr_dec was reached through a block
+  link and is already decoded.
+  \brief Used by EmitDispatch and EmitChain functions */
+/***************************************/
+void EmitDispatchBody(FILE *output, int base_indent, int linked) {
+
   fprintf( output, "%sac_instr_counter++;\n", INDENT[base_indent]);
   fprintf( output, "%sunsigned ins_id;\n", INDENT[base_indent]);
   
@@ -4280,13 +5231,14 @@ void EmitDispatch(FILE *output, int base_indent) {
     base_indent++;
 
     if( ACStatsFlag ){
-      fprintf( output, "%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
-              INDENT[base_indent], project_name);
+      fprintf( output, "%s%sISA.stats[%s_stat_ids::SYSCALLS]++; \\\n", 
+              INDENT[base_indent], ACSamplingFlag ? "if (sampler.detailed()) " : "",
+              project_name);
     }
 
     if( ACDebugFlag ){
       fprintf( output, "%sif( ac_do_trace != 0 )\\\n", INDENT[base_indent]);
-      fprintf( output, "%strace_file << hex << ac_pc << dec << endl; \\\n", 
+      fprintf( output, "%sif (ac_bin_trace) ac_bin_trace->add(ac_pc, 0); else trace_file << hex << ac_pc << dec << endl; \\\n", 
               INDENT[base_indent + 1]);
     }
     if( ACHLTraceFlag)
@@ -4323,20 +5275,37 @@ void EmitDispatch(FILE *output, int base_indent) {
     }
   }
   
-  if( ACFullDecode ) {
-    fprintf( output, "%sinstr_dec = (DEC_CACHE + (ac_pc", 
+  if( linked )
+    fprintf( output, "%sins_id = instr_dec->id;\n\n", INDENT[base_indent]);
+  else if( ACFullDecode ) {
+    fprintf( output, "%sinstr_dec = dec_cache_at(ac_pc", 
              INDENT[base_indent]);
     if( ACIndexFix ) 
       fprintf( output, " / %d", largest_format_size / 8);
-    fprintf( output, "));\n");
+    fprintf( output, ");\n");
     fprintf( output, "%sins_id = instr_dec->id;\n\n", INDENT[base_indent]);
   }
   else EmitDecodification(output, base_indent);
+
+  //Links the instruction chain() stopped at to the one just fetched.
+  //Fall-through successors become succ, taken branches the exit link.
+  if( ACBlockChaining && !linked ) {
+    fprintf( output, "%sif (chain_from) {\n", INDENT[base_indent]);
+    fprintf( output, "%sif (ac_pc == chain_pc)\n", INDENT[base_indent + 1]);
+    fprintf( output, "%schain_from->succ = instr_dec;\n", INDENT[base_indent + 2]);
+    fprintf( output, "%selse {\n", INDENT[base_indent + 1]);
+    fprintf( output, "%schain_from->exit_pc = ac_pc;\n", INDENT[base_indent + 2]);
+    fprintf( output, "%schain_from->exit = instr_dec;\n", INDENT[base_indent + 2]);
+    fprintf( output, "%s}\n", INDENT[base_indent + 1]);
+    fprintf( output, "%schain_from = NULL;\n", INDENT[base_indent + 1]);
+    fprintf( output, "%s}\n\n", INDENT[base_indent]);
+  }
   
   EmitInstrExecIni(output, base_indent);
   
   if( ACStatsFlag ){
-    fprintf( output, "%sif(!ac_wait_sig && ins_id) {\n", INDENT[base_indent]);
+    fprintf( output, "%sif(!ac_wait_sig && ins_id%s) {\n", INDENT[base_indent],
+             ACSamplingFlag ? " && sampler.detailed()" : "");
     fprintf( output, "%sISA.stats[%s_stat_ids::INSTRUCTIONS]++;\n", 
             INDENT[base_indent + 1], project_name);
     fprintf( output, "%s(*(ISA.instr_stats[ins_id]))[%s_instr_stat_ids::COUNT]++;\n", 
@@ -4346,7 +5315,7 @@ void EmitDispatch(FILE *output, int base_indent) {
 
   if( ACDebugFlag ){
     fprintf( output, "%sif( ac_do_trace != 0 ) \n", INDENT[base_indent]);
-    fprintf( output, PRINT_TRACE, INDENT[base_indent + 1]);
+    fprintf( output, PRINT_TRACE, INDENT[base_indent + 1], INDENT[base_indent + 1]);
   }
   if( ACHLTraceFlag)
   {
@@ -4376,21 +5345,178 @@ void EmitDispatch(FILE *output, int base_indent) {
 
   if (ACPowerEnable) {
     fprintf(output, "\n\n#ifdef POWER_SIM\n");
-    fprintf(output, "ps.update_stat_power(ins_id);\n");
+    if (ACSamplingFlag)
+      fprintf(output, "if (sampler.detailed()) ps.update_stat_power(ins_id);\n");
+    else
+      fprintf(output, "ps.update_stat_power(ins_id);\n");
     fprintf(output, "#endif\n\n");
   }
 
+  if( ACBlockChaining )
+    fprintf( output, "%schain_pc = ac_pc + ISA.instr_table[ins_id].ac_instr_size;\n", 
+             INDENT[base_indent]);
+  else if( ACProfileFlag )
+    fprintf( output, "%sprofile_pc = ac_pc + ISA.instr_table[ins_id].ac_instr_size;\n", 
+             INDENT[base_indent]);
   
   if(ACDecCacheFlag)
     fprintf( output, "%sreturn instr_dec->end_rot;\n", INDENT[base_indent]);  
   else
     fprintf( output, "%sreturn IntRoutine[ins_id];\n", INDENT[base_indent]);  
-  
+}
+
+
+/**************************************/
+/*!  Emits the Chain Function used by Block Chaining.
+  Decoded instructions are linked into blocks: succ points to the
+  fall-through successor and exit to the block the last taken
+  branch went to. chain() follows these links instead of looking
+  the decoder cache up, and only the exit link is checked for a
+  stale decodification. Missing links and every AC_MAX_BLOCK_SIZE
+  instructions go through dispatch(), which runs the block checks
+  (stop flag, quantum sync, interrupts and PC bounds) and links the
+  instruction it fetches.
+  \brief Used by CreateProcessorImpl function */
+/***************************************/
+void EmitChain(FILE *output, int base_indent) {
+
+  fprintf( output, "%svoid* %s::chain() {\n", 
+           INDENT[base_indent], project_name);
+
+  base_indent++;
+
+  if( ACDebugFlag ){
+    fprintf( output, "%sextern bool ac_do_trace;\n", INDENT[base_indent]);
+    fprintf( output, "%sextern ofstream trace_file;\n", INDENT[base_indent]);
+  }
+
+  fprintf( output, "%sDecCacheItem* next;\n\n", INDENT[base_indent]);
+  fprintf( output, "%sif (ac_pc == chain_pc)\n", INDENT[base_indent]);
+  fprintf( output, "%snext = instr_dec->succ;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%selse {\n", INDENT[base_indent]);
+  COMMENT(INDENT[base_indent + 1], "Block exit: code written since the link was made is decoded again.");
+  fprintf( output, "%snext = (ac_pc == instr_dec->exit_pc) ? instr_dec->exit : NULL;\n", 
+           INDENT[base_indent + 1]);
+  if( !ACFullDecode )
+    fprintf( output, "%sif (next && !next->valid)\n%snext = NULL;\n", 
+             INDENT[base_indent + 1], INDENT[base_indent + 2]);
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+
+  fprintf( output, "%sif (__builtin_expect(!next || (--chain_left == 0), 0)) {\n", INDENT[base_indent]);
+  fprintf( output, "%schain_from = instr_dec;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sreturn dispatch();\n", INDENT[base_indent + 1]);
+  fprintf( output, "%s}\n", INDENT[base_indent]);
+  fprintf( output, "%sinstr_dec = next;\n\n", INDENT[base_indent]);
+
+  if( ACProfileFlag )
+    fprintf( output, "%sif (ac_pc != chain_pc) profiler.enter(ac_pc, ac_instr_counter);\n", 
+             INDENT[base_indent]);
+
+  EmitDispatchBody(output, base_indent, 1);
+
   base_indent--;
   fprintf( output, "%s}\n\n", INDENT[base_indent]);  
 }
 
 
+/**************************************/
+/*!  Emits the GDB breakpoint traps.
+  Breakpoints replace the interpretation routine of their
+  DecCacheItem by TrapRoutine, so running code pays nothing for
+  them. Single steps stop at the one-shot ac_trap_at threshold
+  checked by the update method.
+  \brief Used by CreateProcessorImpl function */
+/***************************************/
+void EmitGDBTraps(FILE *output, int base_indent) {
+  extern int largest_format_size;
+
+  fprintf( output, "%s// Stops the simulation and hands it to GDB. next is the instruction\n", INDENT[base_indent]);
+  fprintf( output, "%s// count before the instruction where a single step stops again.\n", INDENT[base_indent]);
+  fprintf( output, "%svoid %s::gdb_stop(unsigned long long next) {\n", 
+           INDENT[base_indent], project_name);
+  fprintf( output, "%sgdbstub->process_bp();\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sgdb_stopped_at = next;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sif (gdbstub->stepping()) {\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sac_trap_at = next;\n", INDENT[base_indent + 2]);
+  if (ACBlockChaining)
+    fprintf( output, "%schain_left = 1;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%s}\n", INDENT[base_indent + 1]);
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+
+  fprintf( output, "%s// Single step: stops before the next instruction.\n", INDENT[base_indent]);
+  fprintf( output, "%svoid %s::gdb_step() {\n", INDENT[base_indent], project_name);
+  fprintf( output, "%sac_trap_at = ~0ULL;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sgdb_stop(ac_instr_counter + 1);\n", INDENT[base_indent + 1]);
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+
+  fprintf( output, "%s// Reached instead of the interpretation routine of a breakpoint.\n", INDENT[base_indent]);
+  fprintf( output, "%svoid* %s::gdb_trap() {\n", INDENT[base_indent], project_name);
+  base_indent++;
+  COMMENT(INDENT[base_indent], "Once per instruction: a single step may already have stopped here.");
+  fprintf( output, "%sif (ac_instr_counter != gdb_stopped_at) {\n", INDENT[base_indent]);
+  fprintf( output, "%sunsigned pc = ac_pc;\n\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sgdb_stop(ac_instr_counter);\n", INDENT[base_indent + 1]);
+  COMMENT(INDENT[base_indent + 1], "GDB moved the PC or rewrote the instruction: fetch again.");
+  fprintf( output, "%sif ((ac_pc != pc)", INDENT[base_indent + 1]);
+  if (!ACFullDecode)
+    fprintf( output, " || !instr_dec->valid");
+  fprintf( output, ") {\n");
+  fprintf( output, "%sac_instr_counter--;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%sreturn dispatch();\n", INDENT[base_indent + 2]);
+  fprintf( output, "%s}\n", INDENT[base_indent + 1]);
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+  fprintf( output, "%sif (instr_dec->end_rot != TrapRoutine)\n", INDENT[base_indent]);
+  fprintf( output, "%sreturn instr_dec->end_rot;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sstd::map<unsigned, void*>::iterator trap = gdb_traps.find(ac_pc);\n", 
+           INDENT[base_indent]);
+  fprintf( output, "%sreturn (trap != gdb_traps.end()) ? trap->second : IntRoutine[instr_dec->id];\n", 
+           INDENT[base_indent]);
+  base_indent--;
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+
+  fprintf( output, "%s// Patches the decoded instruction at address to trap into GDB, or\n", INDENT[base_indent]);
+  fprintf( output, "%s// restores it. Instructions not decoded yet are patched when decoded.\n", INDENT[base_indent]);
+  fprintf( output, "%svoid %s::set_breakpoint_trap(unsigned int address, bool insert) {\n", 
+           INDENT[base_indent], project_name);
+  base_indent++;
+  fprintf( output, "%sDecCacheItem* item = NULL;\n", INDENT[base_indent]);
+  fprintf( output, "%sunsigned index = address", INDENT[base_indent]);
+  if (ACIndexFix)
+    fprintf( output, " / %d", largest_format_size / 8);
+  fprintf( output, ";\n\n");
+  fprintf( output, "%sif ((address < dec_cache_size) && DEC_CACHE[index >> %s_parms::AC_DEC_CACHE_PAGE_BITS]) {\n", 
+           INDENT[base_indent], project_name);
+  fprintf( output, "%sitem = DEC_CACHE[index >> %s_parms::AC_DEC_CACHE_PAGE_BITS] + \n", 
+           INDENT[base_indent + 1], project_name);
+  fprintf( output, "%s(index & ((1U << %s_parms::AC_DEC_CACHE_PAGE_BITS) - 1));\n", 
+           INDENT[base_indent + 3], project_name);
+  if (!ACFullDecode) {
+    fprintf( output, "%sif (!item->valid)\n", INDENT[base_indent + 1]);
+    fprintf( output, "%sitem = NULL;\n", INDENT[base_indent + 2]);
+  }
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+
+  fprintf( output, "%sif (insert) {\n", INDENT[base_indent]);
+  fprintf( output, "%sif (gdb_traps.count(address))\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sreturn;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%sgdb_traps[address] = item ? item->end_rot : NULL;\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sif (item)\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sitem->end_rot = TrapRoutine;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%s}\n", INDENT[base_indent]);
+  fprintf( output, "%selse {\n", INDENT[base_indent]);
+  fprintf( output, "%sstd::map<unsigned, void*>::iterator trap = gdb_traps.find(address);\n", 
+           INDENT[base_indent + 1]);
+  fprintf( output, "%sif (trap == gdb_traps.end())\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sreturn;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%sif (item && (item->end_rot == TrapRoutine))\n", INDENT[base_indent + 1]);
+  fprintf( output, "%sitem->end_rot = trap->second;\n", INDENT[base_indent + 2]);
+  fprintf( output, "%sgdb_traps.erase(trap);\n", INDENT[base_indent + 1]);
+  fprintf( output, "%s}\n", INDENT[base_indent]);
+  base_indent--;
+  fprintf( output, "%s}\n\n", INDENT[base_indent]);
+}
+
+
 /**************************************/
 /*!  Emits the Vector with Address of the 
  * Interpretation Routines used by Threading
@@ -4413,6 +5539,9 @@ void EmitVetLabelAt(FILE *output, int base_indent) {
   fprintf(output, "};\n\n");
   
   fprintf(output, "%sIntRoutine = vet;\n\n", INDENT[base_indent]);
+
+  if (ACGDBTraps)
+    fprintf(output, "%sTrapRoutine = &&I_Trap;\n\n", INDENT[base_indent]);
 }
 
 
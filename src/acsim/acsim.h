@@ -123,6 +123,11 @@ enum _ac_cmd_options {
   OPFullDecode,
   OPCurInstrID,
   OPPower,
+  OPBlockChaining,
+  OPProfile,
+  OPCheckpoint,
+  OPSampling,
+  OPCosim,
   ACNumberOfOptions,
 };
 
@@ -215,6 +220,7 @@ void CreateIntrTLM2Tmpl(void); /*****/
  * @{
 */
 void EmitUpdateMethod( FILE *output, int base_indent );                            //!< Emit reg update method for non-pipelined architectures.
+int DelayQueues(ac_sto_list *pstorage);                                           //!< Number of delayed write queues of a storage tracked in ac_delay_mask
 void EmitProcessorBhv( FILE *output, int base_indent);                             //!< Emit processor behavior for a single-cycle processor.
 void EmitInstrExec(FILE *output, int base_indent);                                 //!< Emit code for executing an instruction behavior
 void EmitDecodification(FILE *output, int base_indent);                            //!< Emit for instruction decodification
@@ -223,7 +229,18 @@ void EmitCacheDeclaration(FILE *output, ac_sto_list* pstorage, int base_indent);
 void EmitDecCache(FILE *output, int base_indent);                                  //!< Emits a Decoder Cache Structure
 void EmitDecCacheAt(FILE *output, int base_indent);                                //!< Emits a Decoder Cache Attribution
 void EmitDispatch(FILE *output, int base_indent);                                  //!< Emits the Dispatch Function used by Threading
+void EmitDispatchBody(FILE *output, int base_indent, int linked);                  //!< Emits the per-instruction part of the Dispatch Function
+void EmitChain(FILE *output, int base_indent);                                     //!< Emits the Chain Function used by Block Chaining
+void EmitGDBTraps(FILE *output, int base_indent);                                  //!< Emits the GDB breakpoint traps used by threaded simulators
 void EmitVetLabelAt(FILE *output, int base_indent);                                //!< Emits the Vector with Address of the Interpretation Routines used by Threading
+void EmitCheckpoint(FILE *output, int base_indent);                                //!< Emits the checkpoint save and restore methods
+void EmitCheckpointInit(FILE *output, int base_indent);                            //!< Emits the checkpoint restore and schedule done by init()
+void EmitCosimState(FILE *output, int base_indent);                                //!< Emits the register list compared by the co-simulation
+void EmitGDBTargetDescription(FILE *output, int base_indent);                      //!< Emits the GDB target.xml built from the register list
+void EmitSampling(FILE *output, int base_indent);                                  //!< Emits the sampled simulation phase changes
+void EmitSamplingInit(FILE *output, int base_indent);                              //!< Emits the --sample handling in init()
+void EmitVerifyStorages(FILE *output, int base_indent, int open);                  //!< Emits the co-verification device list or log sending
+void EmitProfileDecode(FILE *output, int base_indent);                             //!< Emits the decoder lookup of the basic block profiler
 //@}
 
 /** @defgroup utilitfunc Utility Functions
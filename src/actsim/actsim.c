@@ -1637,6 +1637,8 @@ void CreateProcessorHeader(void)
   fprintf(output, "%sunsigned id;\n", INDENT[2]);
   fprintf(output, "%sunsigned* instr_dec;\n", INDENT[2]);
   fprintf(output, "%sac_instr_t* instr_vec;\n", INDENT[2]);
+  if (!ACDecCacheFlag)
+   fprintf(output, "%sac_instr_t instr_buf;\n", INDENT[2]);
   fprintf(output, "%s%s_arch* ap;\n", INDENT[2], project_name);
  }
  fprintf(output, "%sbool has_delayed_load;\n", INDENT[2]);
@@ -1959,6 +1961,8 @@ void CreateStgHeader(ac_stg_list* stage_list, char* pipe_name)
   fprintf(output, "%stypedef ac_instr<%s_parms::AC_DEC_FIELD_NUMBER> ac_instr_t;\n",
           INDENT[3], project_name);
   fprintf(output, "%s%s_arch& ap;\n", INDENT[3], project_name);
+  if ((pstage->id == 1) && !ACDecCacheFlag)
+   fprintf(output, "%sac_instr_t instr_buf;\n", INDENT[3]);
   if ((pstage->id == 1) && ACABIFlag)
   {
    fprintf(output, "%sint flushes_left;\n", INDENT[3]);
@@ -2761,14 +2765,19 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name)
           project_name, stage_name, project_name, stage_name, INDENT[0]);
   fprintf(output, "%sunsigned ins_id;\n", INDENT[1]);
   if (pstage->id == 1)
+  {
    fprintf(output, "%sunsigned* instr_dec;\n", INDENT[1]);
-  fprintf(output, "%sac_instr_t* instr_vec;\n", INDENT[1]);
+   fprintf(output, "%sac_instr_t* instr_vec;\n", INDENT[1]);
+  }
+  else
+   fprintf(output, "%sconst ac_instr_t* instr_vec;\n", INDENT[1]);
   if (pstage->id != 1)
   {
    fprintf(output, "\n");
    fprintf(output, "%sif (ac_stop_flag)\n%sreturn;\n", INDENT[1], INDENT[2]);
    fprintf(output, "%sif (is_stalled())\n%sctrl.request_update();\n", INDENT[1], INDENT[2]);
-   fprintf(output, "%sinstr_vec = new ac_instr_t(regin->read());\n", INDENT[1]);
+   // The instruction stays in the input register until the clock edge.
+   fprintf(output, "%sinstr_vec = &regin->read();\n", INDENT[1]);
    fprintf(output, "%sins_id = instr_vec->get(IDENT);\n", INDENT[1]);
    fprintf(output, "%sif (ins_id != 0)\n%s{\n", INDENT[1], INDENT[1]);
    fprintf(output, "%sisa.current_instruction_id = ins_id;\n", INDENT[2]);
@@ -2803,7 +2812,6 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name)
    fprintf(output, "%s}\n", INDENT[1]);
    if (pstage->id != stage_num)
     fprintf(output, "%sregout->write(*instr_vec);\n", INDENT[1]);
-   fprintf(output, "%sdelete instr_vec;\n", INDENT[1]);
    fprintf(output, "%sdone.notify();\n", INDENT[1]);
    fprintf(output, "%sreturn;\n", INDENT[1]);
    fprintf(output, "%s}\n", INDENT[0]);
@@ -3733,10 +3741,12 @@ void EmitDecodification(FILE* output, int base_indent)
 #endif
  }
  fprintf(output, "%sap.quant = 0;\n", INDENT[base_indent]);
+ fprintf(output, "%sunsigned dec_fields[%s_parms::AC_DEC_FIELD_NUMBER];\n",
+         INDENT[base_indent], project_name);
  if (ACDecCacheFlag)
  {
   fprintf(output,
-          "%sins_cache->instr_p = new ac_instr_t((isa.decoder)->Decode(reinterpret_cast<unsigned char*>(ap.buffer), ap.quant));\n",
+          "%sins_cache->instr_p = new ac_instr_t((isa.decoder)->Decode(reinterpret_cast<unsigned char*>(ap.buffer), ap.quant, dec_fields));\n",
           INDENT[base_indent]);
   fprintf(output, "%sins_cache->valid = 1;\n", INDENT[base_indent]);
   base_indent--;
@@ -3746,10 +3756,10 @@ void EmitDecodification(FILE* output, int base_indent)
  else
  {
   fprintf(output,
-          "%sinstr_dec = (isa.decoder)->Decode(reinterpret_cast<unsigned char*>(ap.buffer), ap.quant);\n",
-          INDENT[base_indent]);
-  fprintf(output, "%sinstr_vec = new ac_instr_t(instr_dec);\n",
+          "%sinstr_dec = (isa.decoder)->Decode(reinterpret_cast<unsigned char*>(ap.buffer), ap.quant, dec_fields);\n",
           INDENT[base_indent]);
+  fprintf(output, "%sinstr_buf.assign(instr_dec);\n", INDENT[base_indent]);
+  fprintf(output, "%sinstr_vec = &instr_buf;\n", INDENT[base_indent]);
  }
  // Checking if it is a valid instruction.
  fprintf(output, "%sins_id = instr_vec->get(IDENT);\n",
@@ -3892,8 +3902,6 @@ void EmitInstrExec(FILE* output, int base_indent)
  if (fetch_stage && fetch_stage->next)
  // Not very bright, but someone might have done it! The monostage pipeline! --Marilia
   fprintf(output, "%sregout->write(*instr_vec);\n", INDENT[base_indent]);
- if (!ACDecCacheFlag)
-  fprintf(output, "%sdelete instr_vec;\n", INDENT[base_indent]);
  return;
 }
 
@@ -3904,7 +3912,6 @@ void EmitInstrExec(FILE* output, int base_indent)
 /***************************************/
 void EmitFetchInit(FILE* output, int base_indent)
 {
- extern int HaveMultiCycleIns;
  extern ac_pipe_list* pipe_list;
 
  if (!ACDecCacheFlag)
@@ -3943,8 +3950,6 @@ void EmitFetchInit(FILE* output, int base_indent)
  fprintf(output, "%s}\n", INDENT[base_indent + 1]);
  fprintf(output, "%selse\n%s{\n", INDENT[base_indent + 1],
          INDENT[base_indent + 1]);
- if (HaveMultiCycleIns && !ACDecCacheFlag)
-  fprintf(output, "%sdelete instr_vec;\n", INDENT[base_indent + 2]);
  fprintf(output, "%sap.decode_pc = ac_pc;\n", INDENT[base_indent + 2]);
  fprintf(output, "%s}\n", INDENT[base_indent + 1]);
  return;
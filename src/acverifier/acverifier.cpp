@@ -13,40 +13,47 @@
  * @date      Mon, 19 Jun 2006 15:33:19 -0300
  *
  * @brief     The ArchC co-verification engine
- *            This file contains functions to control the ArchC 
+ *            This file contains functions to control the ArchC
  *            co-verification engine. This engine will supervise
  *            simulation of two ArchC models monitoring updates to the
- *            storage devices. This is accomplished through IPC messages
+ *            storage devices. This is accomplished through a shared
+ *            memory ring per model (see ac_verify_link.H)
  *
  * @attention Copyright (C) 2002-2006 --- The ArchC Team
- * 
- * This program is free software; you can redistribute it and/or modify 
- * it under the terms of the GNU General Public License as published by 
- * the Free Software Foundation; either version 2 of the License, or 
- * (at your option) any later version. 
- * 
- * This program is distributed in the hope that it will be useful, 
- * but WITHOUT ANY WARRANTY; without even the implied warranty of 
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the 
- * GNU General Public License for more details. 
- * 
- * You should have received a copy of the GNU General Public License 
- * along with this program; if not, write to the Free Software 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  *
  */
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <string.h>
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
 
-#include "ac_msgbuf.H"
+#include "ac_verify_link.H"
 
 #define REFERENCE_MODEL 0
 #define DUV_MODEL 1
@@ -58,21 +65,56 @@
 using namespace std;
 
 char ACVersion[] = "0.9-beta";
-//This is the maximal number of unmatched logs accepted before aborting co-verification
+//This is the maximal number of mismatches accepted before aborting co-verification
 static const unsigned int AC_MAX_UNMATCHED = 20;
+//This is the maximal number of updates a model may be ahead of the other
+//one. Past it, the verifier stops draining its ring until the other model
+//catches up, and the full ring stalls the model.
+static const unsigned long long AC_MAX_LEAD = 1ULL << 22;
 
-//These variables will be used to control and access message queues
+//These variables will be used to control and access the shared rings
 //and child processes
-key_t ref_key, duv_key;
-int ref_msqid, duv_msqid;
-pid_t ref_pid, duv_pid;
-struct msqid_ds ref_info, duv_info;
-
-//Device list for both models
-struct dev_list *ref_devlist = NULL, *duv_devlist = NULL;
-struct start_msgbuf ref_sbuf, duv_sbuf;
-struct dev_loglist *loglist = NULL;
-
+char shm_name[64];
+ac_verify_shm *shm = NULL;
+pid_t model_pid[2];
+int model_status[2];
+bool model_exited[2], model_finished[2];
+const char *model_name[2] = { "Reference", "DUV" };
+unsigned checkpoint = 0;
+
+//Updates of an address not matched yet. They all come from the same model,
+//since an update from the other one is matched against the first of them.
+struct pending_update {
+	uint64_t value;
+	double time;
+};
+
+struct pending_updates {
+	int model;
+	unsigned first;
+	vector<pending_update> updates;
+
+	pending_updates(): model(0), first(0) {}
+};
+
+struct log_mismatch {
+	uint32_t addr;          //Window index in checkpoint mode
+	pending_update ref, duv;  //Hash and window size in checkpoint mode
+};
+
+//Verification state of a device, indexed by address
+struct dev_state {
+	string name;
+	unordered_map<uint32_t, pending_updates> pending;
+	deque<ac_verify_record> windows;  //Checkpoint windows not matched yet
+	int windows_model;
+	vector<log_mismatch> mismatches;
+};
+
+vector<dev_state> devices;
+vector<int> dev_index[2];           //Ring device index -> devices index
+unsigned long long pending_total[2];
+unsigned errors = 0;
 
 
 
@@ -113,31 +155,34 @@ inline void ddprintf(const char *format, ...) {}
 
 //Function Prototypes
 void CheckOptions(int model);
-void ListInit(struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf );
+void CreateRings(void);
+void StartModel(int model, char **model_argv);
 void CheckListConsistency(void);
-void AddLog( long type, change_log log, int device );
-void MatchLogs( void);
+void AddLog( int model, const ac_verify_record &log );
+void AddWindow( int model, dev_state &dev, const ac_verify_record &log );
 
-//void DoIt(void);
 void DoItOntheFly(void);
 void FinishIt(void);
-void ChangeDump( struct dev_loglist *pllist );
+void ChangeDump( ofstream &covfile, dev_state &dev );
 
 /* Display the command line options accepted by ArchC verifier. */
 static void DisplayHelp (){
   printf ("==================================================\n");
   printf (" This is ArchC Verifier for ArchC version %s\n", ACVersion);
   printf ("==================================================\n\n");
-  printf ("Usage: ac_verifier REF_model DUV_model APP [--ref_args=arguments] [--duv_args=arguments]\n\n");
+  printf ("Usage: ac_verifier [--checkpoint=N] REF_model DUV_model APP [--ref_args=arguments] [--duv_args=arguments]\n\n");
   printf ("    Where:\n\n");
   printf ("    --> \"REF_model\" and \"DUV_model\" stand for the path to the executable files\n");
   printf ("         of each model respectively.\n\n");
 	printf ("    --> \"APP\" stands for the running application file. You must specify the application \n");
-	printf ("         to be loaded using --load option, like in regular ArchC simulations.\n\n");        
+	printf ("         to be loaded using --load option, like in regular ArchC simulations.\n\n");
 	printf ("    --> \"arguments\" stands for the set of arguments to be passed to the running application. \n");
-	printf ("         It must be specified both for the reference and duv models.\n");         
-	printf ("         You may specify different arguments for the two models. Like different names for\n");         
-	printf ("         output files that you want to compare after the simulation, for example.\n");         
+	printf ("         It must be specified both for the reference and duv models.\n");
+	printf ("         You may specify different arguments for the two models. Like different names for\n");
+	printf ("         output files that you want to compare after the simulation, for example.\n\n");
+	printf ("    --> \"--checkpoint=N\" makes the models send a hash of every N updates of each device\n");
+	printf ("         instead of the updates themselves. Mismatches are then reported per window of N\n");
+	printf ("         updates: rerun without it to see the faulty updates.\n");
   printf ("\n\n");
 }
 
@@ -150,25 +195,17 @@ void ABORT(){
 
 	cerr << "Aborting co-verification ..." << endl;
 
-	//Deleting message queues
-	if (msgctl(ref_msqid, IPC_RMID, NULL) == -1) {
-		perror("msgctl");
-		cerr << "Could not delete Ref model msg queue."<<endl;
-	}
-
-	if (msgctl(duv_msqid, IPC_RMID, NULL) == -1) {
-		perror("msgctl");
-		cerr << "Could not delete Ref model msg queue."<<endl;
-	}
-
-	if (kill(ref_pid, 15)== -1) {
-		perror("kill");
-		cerr << "Could not terminate Ref model process."<<endl;
+	//Deleting the shared rings
+	if (shm && shm_unlink(shm_name) == -1) {
+		perror("shm_unlink");
+		cerr << "Could not delete the co-verification rings."<<endl;
 	}
 
-	if (kill(duv_pid, 15)== -1) {
-		perror("kill");
-		cerr << "Could not terminate DUV model process."<<endl;
+	for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+		if (!model_exited[model] && kill(model_pid[model], 15)== -1) {
+			perror("kill");
+			cerr << "Could not terminate " << model_name[model] << " model process."<<endl;
+		}
 	}
 
 	exit(1);
@@ -178,22 +215,23 @@ void ABORT(){
 /////////////////////////////////////////////
 // This is the main function.
 // It will handle command-line arguments and
-// create message queues.
+// create the shared rings.
 /////////////////////////////////////////////
 int main(int argc, char *argv[])
 {
 		char *ref_argv[argc], *duv_argv[argc];
 		char *ref_version_arg[2];
 		char *duv_version_arg[2];
-		int j,i, nargs; 
+		int j,i, nargs;
 		int ref_status, duv_status;
+		pid_t ref_pid, duv_pid;
 		++argv, --argc;  /* skip over program name */
 
 
-		ref_version_arg[0] =  "--version";
-		ref_version_arg[1] = " 2>refout.tmp";
-		duv_version_arg[0] =  "--version";
-		duv_version_arg[1] = " 2>refout.tmp";
+		ref_version_arg[0] =  (char*) "--version";
+		ref_version_arg[1] = (char*) " 2>refout.tmp";
+		duv_version_arg[0] =  (char*) "--version";
+		duv_version_arg[1] = (char*) " 2>refout.tmp";
 
 		//The user asked for help ...
 		if( !argv[0] || !strcmp(argv[0], "--help") || !strcmp(argv[0], "-h")){
@@ -201,6 +239,15 @@ int main(int argc, char *argv[])
 			return 0;
 		}
 
+		if( !strncmp( argv[0], "--checkpoint=", 13) ){
+			checkpoint = strtoul(argv[0] + 13, NULL, 0);
+			if( !checkpoint ){
+				AC_ERROR("Invalid checkpoint window: " << argv[0] + 13);
+				exit(1);
+			}
+			++argv, --argc;
+		}
+
 		//We need at least 3 arguments:
 		//1. Path for the reference model
 		//2. Path for the duv model
@@ -219,31 +266,6 @@ int main(int argc, char *argv[])
 		}
 
 
-
-		//Creating message queues.
-    if ((ref_key = ftok(argv[0], 'A')) == -1) {
-        perror("ftok");
-        exit(1);
-    }
-		dprintf("Reference model queue key: %d\n",ref_key);
-
-    if ((duv_key = ftok(argv[1], 'A')) == -1) {
-        perror("ftok");
-        exit(1);
-    }
-		dprintf("DUV model queue key: %d\n",duv_key);
-
-    if ((ref_msqid = msgget(ref_key, 0666 | IPC_CREAT)) == -1) {
-        perror("msgget");
-        exit(1);
-    }
-    
-    if ((duv_msqid = msgget(duv_key, 0666 | IPC_CREAT)) == -1) {
-        perror("msgget");
-        exit(1);
-    }
-
-
 		/* Preparing arguments to be passed for both models */
 
 		//Storing program name and application to be runned
@@ -266,14 +288,14 @@ int main(int argc, char *argv[])
 				dprintf("Running app has no args\n");
 				ref_argv[2] = NULL;
 				duv_argv[2] = NULL;
-		}				
-			
+		}
+
 		argv+=3;
 		i=0;
 		while( i <nargs ){ //This means that we have arguments to pass to the running app
-			
+
 			if( !strncmp( argv[i], "--ref_args=", 11) ){
-				
+
 				//Storing Reference model running app args
 				dprintf("Storing Reference model running app args\n");
 				ref_argv[2] = (char*)malloc(strlen(argv[i]) - 10); //1st arg is after the '=' signal
@@ -283,9 +305,9 @@ int main(int argc, char *argv[])
 				dprintf("Storing  arg %s\n", ref_argv[2]);
 
 				while( (i<nargs) && (strncmp( argv[i], "--duv_args=", 11) )){
-					
+
 					ref_argv[j] = (char*)malloc(strlen(argv[i])+1);
-					strcpy(ref_argv[j], argv[i]);					
+					strcpy(ref_argv[j], argv[i]);
 					dprintf("Storing  arg %s\n", ref_argv[j]);
 					i++;
 					j++;
@@ -295,7 +317,7 @@ int main(int argc, char *argv[])
 			}
 
 			if( !strncmp( argv[i], "--duv_args=", 11) ){  //There are duv model args
-				
+
 				//Storing DUV model running app args
 				dprintf("Storing DUV model running app args\n");
 				duv_argv[2] = (char*)malloc(strlen(argv[i]) - 10); //1st arg is after the '=' signal
@@ -303,10 +325,10 @@ int main(int argc, char *argv[])
 				i++;
 				j=3;
 				dprintf("Storing  arg %s\n", duv_argv[2]);
-				
+
 				while( (i<nargs) && (strncmp( argv[i], "--ref_args=", 11) )){
 					duv_argv[j] = (char*)malloc(strlen(argv[i])+1);
-					strcpy(duv_argv[j], argv[i]);					
+					strcpy(duv_argv[j], argv[i]);
 					dprintf("Storing  arg %s\n", duv_argv[j]);
 					i++;
 					j++;
@@ -314,7 +336,7 @@ int main(int argc, char *argv[])
 				dprintf("DUV running application will receive %d arguments\n", j-2);
 				duv_argv[j] = NULL;
 			}
-		}		
+		}
 
 		//Checking if both models were generated with the -v version.
 		//Running  models with --version option.
@@ -341,44 +363,23 @@ int main(int argc, char *argv[])
 
 		//Now everything was checked. Let's start the co-verification process
 		//
+		CreateRings();
 
 		/* Creating process for both models */
-		if( !(ref_pid = fork()) ){
-			execv(ref_argv[0], ref_argv);
-		}
-		else{
-			if( !(duv_pid = fork()) ){
-				execv(duv_argv[0], duv_argv);
-			}
-			else{
+		StartModel( REFERENCE_MODEL, ref_argv );
+		StartModel( DUV_MODEL, duv_argv );
 
-				//Initializing both device lists
-				dprintf("REFERENCE MODEL QUEUE (%d) INITIALIZATION:\n\n",ref_msqid);
-				ListInit(&ref_devlist, ref_msqid, (struct start_msgbuf*)&ref_sbuf);
-				dprintf("DUV MODEL QUEUE (%d) INITIALIZATION:\n\n",duv_msqid);
-				ListInit(&duv_devlist, duv_msqid, (struct start_msgbuf*)&duv_sbuf);
+		DoItOntheFly();
 
-				//Device list of both models (ref and duv) must have the same devices (number and names)
-				CheckListConsistency();
+		for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
 
-				DoItOntheFly();
+			if( !model_exited[model] )
+				waitpid(model_pid[model],&model_status[model],0);
 
-				waitpid(ref_pid,&ref_status,0);
-
-				//TODO:Padronizar saida de erro
-				if(!WIFEXITED(ref_status)){
-					cerr << "Reference model returned with error"  <<endl;
-					if(WIFSIGNALED(ref_status))
-						cerr << "Signal : " << WTERMSIG(ref_status)<<endl;
-				}
-
-				waitpid(duv_pid,&duv_status,0);
-
-				if(!WIFEXITED(duv_status)){
-					cerr << "DUV  model returned with error" << endl;
-					if(WIFSIGNALED(duv_status))
-						cerr << "Signal : " << WTERMSIG(duv_status)<<endl;
-				}
+			if(!WIFEXITED(model_status[model])){
+				cerr << model_name[model] << " model returned with error"  <<endl;
+				if(WIFSIGNALED(model_status[model]))
+					cerr << "Signal : " << WTERMSIG(model_status[model])<<endl;
 			}
 		}
 
@@ -388,14 +389,9 @@ int main(int argc, char *argv[])
 		//Run the co-verification....
     printf("Co-verification finished.\n");
 
-		//Deleting message queues
-    if (msgctl(ref_msqid, IPC_RMID, NULL) == -1) {
-        perror("msgctl");
-        exit(1);
-    }
-
-    if (msgctl(duv_msqid, IPC_RMID, NULL) == -1) {
-        perror("msgctl");
+		//Deleting the shared rings
+    if (shm_unlink(shm_name) == -1) {
+        perror("shm_unlink");
         exit(1);
     }
 
@@ -403,68 +399,105 @@ int main(int argc, char *argv[])
 }
 
 
-///////////////////////////////////////////
-// Initialize the device list
-//
-// This function will get the first 
-// messages (see protocol bellow) incoming from a model and 
-// initialize its device list.
-///////////////////////////////////////////
-
 //////////////////////////////////////////////////////////
 // ArchC co-verification protocol:
 //
-// 1st MSG          : Number of devices being checked (N)
-// 2nd ... (N+1) MSG: Name of each device
-// (N+2) ...        : Update logs
+// The verifier creates one ring per model in a shared
+// memory object and passes its name to the models in
+// AC_VERIFY_SHM, and the index of their ring in
+// AC_VERIFY_SIDE.
 //
-// Type 1 are control messages
-// Type 2 are devices names do be verified
-// Type 3 ...  are types created for each device to be verified
+// Each model lists the names of the devices being
+// checked in its ring and raises the started flag. Then
+// it appends update records, tagged with the index of
+// the device, or checkpoint records in checkpoint mode,
+// and closes the stream with an AC_VERIFY_END record.
 //////////////////////////////////////////////////////////
 
-void ListInit( struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf ){
+void CreateRings( ){
 
-	struct dev_msgbuf dbuf;
-	struct dev_list *pdevlist;
-	int i;
+	int fd;
 
+	sprintf(shm_name, "/acverifier.%d", (int) getpid());
+	if ((fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1) {
+		perror("shm_open");
+		exit(1);
+	}
 
-	//Processing first message...
-	if (msgrcv(msqid, sbuf, sizeof(struct start_msgbuf), 0, 0) == -1) {
-		perror("msgrcv");
-		ABORT();
+	if (ftruncate(fd, sizeof(ac_verify_shm)) == -1 ||
+	    (shm = (ac_verify_shm*) mmap(NULL, sizeof(ac_verify_shm), PROT_READ | PROT_WRITE,
+	                                 MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		perror("mmap");
+		shm_unlink(shm_name);
+		exit(1);
 	}
-	
-	//First message must tell the number of devices to be supervised
-	if( sbuf->mtype != 1 ){
-		AC_ERROR("Invalid initialization message: expecting type 1 (control), got type " << sbuf->mtype );
-		ABORT();
+	close(fd);
+
+	//The object is zero filled: rings are empty and not started
+	shm->checkpoint = checkpoint;
+	shm->verifier = getpid();
+	shm->magic = AC_VERIFY_MAGIC;
+	dprintf("Co-verification rings: %s\n", shm_name);
+}
+
+void StartModel( int model, char **model_argv ){
+
+	char side[2] = { (char) ('0' + model), 0 };
+
+	if( !(model_pid[model] = fork()) ){
+		setenv("AC_VERIFY_SHM", shm_name, 1);
+		setenv("AC_VERIFY_SIDE", side, 1);
+		execv(model_argv[0], model_argv);
+		perror("execv");
+		_exit(1);
 	}
-		
-	dprintf("-->Number of devices: %d\n",sbuf->ndevice);
+}
 
-	//2nd ... (N+1) messages must tell the name of the devices to be supervised
-	for( i=0; i< sbuf->ndevice;i++){
-		if (msgrcv(msqid, &dbuf, sizeof(dbuf), 0, 0) == -1) {
-			perror("msgrcv");
-			ABORT();
-		}
+/////////////////////////////////////////////
+// Reaps the models that exited. A model that
+// exits without closing its stream is done
+// once its ring is empty.
+/////////////////////////////////////////////
+void CheckModels( ){
 
-		if( dbuf.mtype != 2 ){
-			AC_ERROR("Invalid initialization message: expecting type 2 (device), got type " << dbuf.mtype);
-			ABORT();
-		}
+	for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
 
-		//Appending to the ref model device list.
-		pdevlist = new (struct dev_list);
-		pdevlist->dbuf = dbuf;
-		pdevlist->next = *model_devlist;
-		*model_devlist = pdevlist;
+		if( model_exited[model] ||
+		    waitpid(model_pid[model],&model_status[model],WNOHANG) != model_pid[model] )
+			continue;
 
-		dprintf("-->Device (%d) name: %s\n", i+1,pdevlist->dbuf.name);
+		dprintf("%s model exited\n", model_name[model]);
+		model_exited[model] = 1;
 	}
+}
+
+///////////////////////////////////////////
+// Sleeps until a model publishes records,
+// or some time passed to look for models
+// that exited.
+///////////////////////////////////////////
+void Wait( bool (*ready)(void) ){
+
+	uint32_t wake = __atomic_load_n(&shm->wake, __ATOMIC_ACQUIRE);
+
+	//Pairs with the fence of the models between publishing their tails
+	//and checking sleeping
+	__atomic_store_n(&shm->sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if( !ready() )
+		ac_verify_futex_wait(&shm->wake, wake, 10000000);
+	__atomic_store_n(&shm->sleeping, 0, __ATOMIC_RELAXED);
+
+	CheckModels();
+}
+
+bool Started( ){
 
+	for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+		if( !__atomic_load_n(&shm->ring[model].started, __ATOMIC_ACQUIRE) && !model_exited[model] )
+			return false;
+	}
+	return true;
 }
 
 ////////////////////////////////////////////
@@ -474,46 +507,115 @@ void ListInit( struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf ){
 ////////////////////////////////////////////
 void CheckListConsistency( ){
 
-	struct dev_list *p1;
-	struct dev_list *p2;
-	struct dev_loglist *pll;
-	unsigned next_type = 2 + ref_sbuf.ndevice;
+	ac_verify_ring &ref = shm->ring[REFERENCE_MODEL];
+	ac_verify_ring &duv = shm->ring[DUV_MODEL];
+	unsigned i, j;
+
+	while( !Started() )
+		Wait( Started );
+
+	for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+		if( !shm->ring[model].started ){
+			AC_ERROR(model_name[model] << " model exited before starting co-verification.");
+			AC_MSG("   Models must be built with -v and AC_VERIFY defined.");
+			ABORT();
+		}
+	}
 
-	if( !ref_devlist || !duv_devlist ){
+	if( !ref.ndevice ){
 		AC_ERROR("Uninitialized device lists.");
 		ABORT();
 	}
 
 	//First check the number of devices
-	if( ref_sbuf.ndevice != duv_sbuf.ndevice ){
-		AC_ERROR("Uninitialized device lists.");
+	if( ref.ndevice != duv.ndevice ){
+		AC_ERROR("Device lists are not consistent. Reference model has " << ref.ndevice <<
+		         " devices, DUV model has " << duv.ndevice << ".");
 		ABORT();
 	}
 
 	//Now check device names.
-	for (p1 = ref_devlist; p1; p1=p1->next ){
+	devices.resize(ref.ndevice);
+	dev_index[REFERENCE_MODEL].resize(ref.ndevice);
+	dev_index[DUV_MODEL].resize(duv.ndevice);
+	for (i = 0; i < ref.ndevice; i++) {
 
-		for( p2 = duv_devlist; p2; p2=p2->next) {
-			if( !strcmp(p1->dbuf.name,p2->dbuf.name))
+		for (j = 0; j < duv.ndevice; j++) {
+			if( !strncmp(ref.names[i], duv.names[j], AC_VERIFY_NAME_SIZE))
 				break;
 		}
-		if( !p2 ){
-			//Didn't find p1 storage in duv's list
-			AC_ERROR("Device lists are not consistent. DUV model does not have a "<< p1->dbuf.name <<" device.");
+		if( j == duv.ndevice ){
+			//Didn't find the device in duv's list
+			AC_ERROR("Device lists are not consistent. DUV model does not have a "<< ref.names[i] <<" device.");
 			ABORT();
 		}
 
-		//Everything is OK for this device, so create its log list
-		pll = new (struct dev_loglist);
-		pll->type = next_type--;  //Device list was created in inverted order, so first type to be processed is the last sent by the models
-		strcpy(pll->name, p1->dbuf.name);
-		pll->next = loglist;
-		loglist = pll;
-		dprintf("Adding device list for %s with type %d\n",pll->name,pll->type);
+		//Everything is OK for this device, so create its state
+		devices[i].name.assign(ref.names[i], strnlen(ref.names[i], AC_VERIFY_NAME_SIZE));
+		dev_index[REFERENCE_MODEL][i] = i;
+		dev_index[DUV_MODEL][j] = i;
+		dprintf("Adding device %s\n", devices[i].name.c_str());
 	}
-		
+
 	dprintf("CheckListConsistency passed successfully.\n");
-	
+
+}
+
+
+///////////////////////////////////////////
+// Consumes the records published by a
+// model. Returns the number of records.
+///////////////////////////////////////////
+unsigned Drain( int model ){
+
+	ac_verify_ring &ring = shm->ring[model];
+	uint64_t head = ring.head;
+	uint64_t tail = __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+	unsigned n = tail - head;
+
+	while( head != tail ){
+
+		const ac_verify_record &log = ring.records[head & (AC_VERIFY_RING_SIZE - 1)];
+
+		if( log.device == AC_VERIFY_END ){
+			model_finished[model] = 1;
+			dprintf("%s model has finished\n", model_name[model]);
+		}
+		else
+			AddLog( model, log );
+
+		//Hand the slots back as we go, so that the model keeps running
+		if( !(++head & (AC_VERIFY_BATCH - 1)) )
+			__atomic_store_n(&ring.head, head, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&ring.head, head, __ATOMIC_RELEASE);
+
+	//A model that exited is done once its ring is empty
+	if( !n && model_exited[model] && !model_finished[model] ){
+		AC_MSG(model_name[model] << " model exited without closing its update stream.");
+		model_finished[model] = 1;
+	}
+
+	return n;
+}
+
+//Whether the verifier may consume updates of a model. A model too far
+//ahead of the other one waits for it.
+bool Drainable( int model ){
+
+	return !model_finished[model] &&
+	       (pending_total[model] < AC_MAX_LEAD || model_finished[!model]);
+}
+
+bool Published( ){
+
+	for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+		if( Drainable(model) &&
+		    (model_exited[model] ||
+		     __atomic_load_n(&shm->ring[model].tail, __ATOMIC_ACQUIRE) != shm->ring[model].head) )
+			return true;
+	}
+	return false;
 }
 
 
@@ -522,282 +624,122 @@ void CheckListConsistency( ){
 //////////////////////////////////////
 void DoItOntheFly(){
 
-	struct log_msgbuf lbuf;
-	bool ref_finished=0, duv_finished=0;
-	int ref_status, duv_status;
-	int i;
+	unsigned idle = 0;
 
-	//Keep "listening" to the models and comparing update logs
-	while( !ref_finished || !duv_finished ){
+	CheckListConsistency();
 
-		if( !ref_finished ){
-			
-			if (msgctl(ref_msqid, IPC_STAT, &ref_info) == -1) {
-        perror("msgctl");
-        ABORT();
-			}
-			
-			ddprintf("REF QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-							ref_info.msg_perm.mode & 0777, ref_info.msg_cbytes, ref_info.msg_qnum, ref_info.msg_qbytes);
-			
-			i = ref_info.msg_qnum;
-
-			//If there is nothing on the queue, the child may have exited. Check it
-			if( !i){
-				waitpid(ref_pid,&ref_status,WNOHANG);
-				if(WIFEXITED(ref_status)){
-					dprintf("Matching logs ... Empty queue! Reference model exited!");
-					if(WIFSIGNALED(ref_status))
-						dprintf("Signal :%d ", WTERMSIG(ref_status));
-					ref_finished = 1;
-				}
-			}
+	//Keep "listening" to the models and comparing update logs
+	while( !model_finished[REFERENCE_MODEL] || !model_finished[DUV_MODEL] ){
 
-			//Consuming ref queue msgs
-			while (i) {
+		unsigned n = 0;
+		bool drainable = false;
 
-				//Listening to Reference model
-				if (msgrcv(ref_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-					perror("msgrcv");
-					ABORT();
-				}
-				// 		cerr << "Log received from ref: ";
-				// 		cerr << lbuf.log <<endl;
-				if( lbuf.log.time == -1 ){
-					ref_finished = 1;
-					dprintf("Reference model has finished\n");
-				}
-				else{
-					//Append to the device list
-					AddLog(lbuf.mtype, lbuf.log, 0 );
-				}
-				i--;
+		for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+			if( Drainable(model) ){
+				drainable = true;
+				n += Drain( model );
 			}
 		}
 
-		if(!duv_finished){
-
-			//Gathering info about ref and duv queues
-			if (msgctl(duv_msqid, IPC_STAT, &duv_info) == -1) {
-        perror("msgctl");
-        ABORT();
-			}
-		
-			ddprintf("DUV QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-							duv_info.msg_perm.mode & 0777, duv_info.msg_cbytes, duv_info.msg_qnum, duv_info.msg_qbytes);
-			
-			i = duv_info.msg_qnum;
-			//If there is nothing on the queue, the child may have exited. Check it
-			if( !i){
-				waitpid(duv_pid,&duv_status,WNOHANG);
-				
-				if(WIFEXITED(duv_status)){
-					dprintf("Matching logs ... Empty queue! DUV  model exited!");
-					if(WIFSIGNALED(duv_status))
-						dprintf("Signal : ", WTERMSIG(duv_status));
-					
-					duv_finished =1;
-				}
-			}
-
-			//Consuming duv queue msgs
-			while (i) {
+		if( errors >= AC_MAX_UNMATCHED ){
+			dprintf("Too many erros founded. Aborting ...\n");
+			FinishIt();
+			ABORT();
+		}
 
-				//Listening to DUV model
-				if (msgrcv(duv_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-					perror("msgrcv");
-					ABORT();
-				}
-				// 		cerr << "Log received from DUV: ";
-				// 		cerr << lbuf.log <<endl;
-				if( lbuf.log.time == -1 ){
-					duv_finished = 1;
-					dprintf("DUV model has finished\n");
-				}
-				else{
-					
-					//Append to the device list
-					AddLog(lbuf.mtype, lbuf.log, 1 );
-				}
-				i--;
-			}
+		//Both models are too far ahead of each other: they diverged
+		if( !drainable ){
+			AC_ERROR("Reference and DUV models diverged: more than " << AC_MAX_LEAD <<
+			         " unmatched updates on each side.");
+			FinishIt();
+			ABORT();
 		}
 
-		MatchLogs();
-		
+		if( n )
+			idle = 0;
+		else if( ++idle < 64 )
+			sched_yield();
+		else
+			Wait( Published );
 	}
 }
 
-// //////////////////////////////////////
-// // The main co-verification loop
-// //////////////////////////////////////
-// void DoIt(){
-
-// 	struct log_msgbuf lbuf;
-// 	int received =0;
-// 	int i;
-// 	bool ref_finished;
-
-// 	//Keep "listening" to the models and comparing update logs
-// 	for(;;){
-
-// 		//Gathering info about ref and duv queues
-//     if (msgctl(duv_msqid, IPC_STAT, &duv_info) == -1) {
-//         perror("msgctl");
-//         ABORT();
-//     }
-		
-//     if (msgctl(ref_msqid, IPC_STAT, &ref_info) == -1) {
-//         perror("msgctl");
-//         ABORT();
-//     }
-		
-// 		dprintf("REF QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-// 						ref_info.msg_perm.mode & 0777, ref_info.msg_cbytes, ref_info.msg_qnum, ref_info.msg_qbytes);
-
-// 		dprintf("DUV QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-// 						duv_info.msg_perm.mode & 0777, duv_info.msg_cbytes, duv_info.msg_qnum, duv_info.msg_qbytes);
-
-// 		if( ref_info.msg_cbytes >= 0.9*ref_info.msg_qbytes ){
-			
-// 			i = ref_info.msg_cbytes;
-			
-// 			cerr << "Log received from ref: "<< i <<" messages"<<endl;
-// 			while(i){
-// 				//Listening to Reference model
-// 				if (msgrcv(ref_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-// 					perror("msgrcv");
-// 					ABORT();
-// 				}
-
-// 				if( lbuf.log.time == -1 ){
-// 					ref_finished = 1;
-// 				 cerr << "Reference model has finished ";
-// 				//						cerr << lbuf.log <<endl;
-// 				}
-// 				//Append to the device list
-// 				AddLog(lbuf.mtype, lbuf.log, 0 );
-// 				i--;
-// 			}
-// 			received = 1;
-// 		}
-		
-// 		if( duv_info.msg_cbytes >= 0.9* duv_info.msg_qbytes ){
-			
-// 			i = duv_info.msg_cbytes;
-			
-// 			cerr << "Log received from duv: "<< i <<" messages"<<endl;
-// 			while(i){
-// 				//Listening to DUV model
-// 				if (msgrcv(duv_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-// 					perror("msgrcv");
-// 					ABORT();
-// 				}
-// 				//	cerr << "Log received from DUV: ";
-// 				//	cerr << lbuf.log <<endl;
-				
-// 				//Append to the device list
-// 				AddLog(lbuf.mtype, lbuf.log, 1 );
-// 				i--;
-// 			}
-// 			received = 1;
-// 		}
-		
-// 		//Check consistency
-// 		if( received ){
-// 			MatchLogs();
-// 			received =0;
-// 		}
-		
-// 	}
-// }
-
 //////////////////////////////////////////
-// Add an update log to the corresponding
-// list.
-// device = 0 indicates operation on ref log
-// device = 1 indicates operation on duv log
+// Match an update log against the pending
+// updates of the same address.
+// model = 0 indicates a ref log
+// model = 1 indicates a duv log
 //////////////////////////////////////////
-void AddLog( long type, change_log log, int device ){
-
-	struct dev_loglist *pllist;
-
-
-	for( pllist = loglist; pllist; pllist=pllist->next){
+void AddLog( int model, const ac_verify_record &log ){
 
-		if( type == pllist->type ){
+	unsigned device = log.device & ~AC_VERIFY_CHECKPOINT;
 
-			if( device )
-				pllist->duv_log.push_back(log);
-			else
-				pllist->ref_log.push_back(log);
-
-			break;
-		}
+	if( device >= dev_index[model].size() ){
+		AC_ERROR("Invalid device ("<<device<<") in log record. Update ignored");
+		return;
 	}
 
-	if( !pllist )
-		AC_ERROR("Invalid type ("<<type<<") in log message. Update ignored");
-	
-}
+	dev_state &dev = devices[dev_index[model][device]];
 
+	if( log.device & AC_VERIFY_CHECKPOINT ){
+		AddWindow( model, dev, log );
+		return;
+	}
 
-/////////////////////////////////////////
-// Match reference and duv update logs
-/////////////////////////////////////////
-void MatchLogs( ){
+	pending_updates &p = dev.pending[log.addr];
+	pending_update u = { log.value, log.time };
 
-	struct dev_loglist *pllist;
-  log_list::iterator refitor;
-  log_list::iterator duvitor;
-	bool flag,error=0;
+	if( p.first == p.updates.size() || p.model == model ){
+		p.model = model;
+		p.updates.push_back(u);
+		pending_total[model]++;
+		return;
+	}
 
-	for( pllist = loglist; pllist; pllist=pllist->next){
+	//Updates of an address happen in the same order in both models
+	pending_update &other = p.updates[p.first];
+	if( other.value != u.value ){
+		log_mismatch m;
+		m.addr = log.addr;
+		m.ref = model ? other : u;
+		m.duv = model ? u : other;
+		dev.mismatches.push_back(m);
+		errors++;
+		ddprintf("Device %s -> Mismatch at %x\n", dev.name.c_str(), log.addr);
+	}
 
-		if( pllist->duv_log.size() &&  pllist->ref_log.size()){
+	pending_total[p.model]--;
+	if( ++p.first == p.updates.size() )
+		dev.pending.erase(log.addr);
+}
 
-			pllist->duv_log.sort();
-			pllist->ref_log.sort();
-			ddprintf("BEFORE MATCHING...\n");
-			ddprintf("Device %s -> Log size:  %d ref and %d duv\n", pllist->name, pllist->ref_log.size(), pllist->duv_log.size());
-			
-#ifdef DDEBUG
-			ChangeDump( pllist);
-#endif
-			refitor = pllist->ref_log.begin();
-			while( refitor != pllist->ref_log.end() ){
-				
-				duvitor = pllist->duv_log.begin();
-				flag = false;
-				
-				while( /*(refitor->time == duvitor->time) &&*/ (duvitor != pllist->duv_log.end())){
-					if( refitor->addr == duvitor->addr &&
-							refitor->value == duvitor->value ){
-						
-						refitor = pllist->ref_log.erase( refitor );
-						duvitor = pllist->duv_log.erase( duvitor );
-						flag = true;
-						break;
-					}
-					duvitor++;
-				}
-				//When we had a match, the iterator was incremented by the erase method
-				if(!flag)
-					refitor++;
-			}
+//////////////////////////////////////////
+// Match a checkpoint window against the
+// same window of the other model.
+//////////////////////////////////////////
+void AddWindow( int model, dev_state &dev, const ac_verify_record &log ){
 
-			ddprintf("AFTER MATCHING...\n");
-			ddprintf("Device %s -> Log size:  %d ref and %d duv\n", pllist->name, pllist->ref_log.size(), pllist->duv_log.size());
-			//Test if we already had too many erros (unmatched logs)
-			if( pllist->ref_log.size() >= AC_MAX_UNMATCHED || pllist->duv_log.size() >= AC_MAX_UNMATCHED )
-				error = 1;
-		}
+	if( dev.windows.empty() || dev.windows_model == model ){
+		dev.windows_model = model;
+		dev.windows.push_back(log);
+		pending_total[model]++;
+		return;
 	}
-	if(error){
-		dprintf("Too many erros founded. Aborting ...\n");
-		FinishIt();
-		ABORT();
+
+	const ac_verify_record &other = dev.windows.front();
+	if( other.value != log.value || other.time != log.time ){
+		log_mismatch m;
+		m.addr = log.addr;
+		m.ref.value = model ? other.value : log.value;
+		m.ref.time = model ? other.time : log.time;
+		m.duv.value = model ? log.value : other.value;
+		m.duv.time = model ? log.time : other.time;
+		dev.mismatches.push_back(m);
+		errors++;
 	}
+
+	pending_total[dev.windows_model]--;
+	dev.windows.pop_front();
 }
 
 
@@ -806,62 +748,105 @@ void MatchLogs( ){
 ////////////////////////////////////////////////////
 void FinishIt(){
 
-	struct dev_loglist *pllist;
+	ofstream covfile;
+	bool failed = false;
+
+	for (unsigned i = 0; i < devices.size(); i++) {
 
-	for( pllist = loglist; pllist; pllist=pllist->next){
+		dev_state &dev = devices[i];
 
-		if( pllist->duv_log.size() ||  pllist->ref_log.size()){
-	
-			AC_ERROR("Co-verification FAILED. Reference and DUV models have inconsistent update logs for device "<< pllist->name);
+		if( dev.mismatches.size() || dev.pending.size() || dev.windows.size() ){
+
+			AC_ERROR("Co-verification FAILED. Reference and DUV models have inconsistent update logs for device "<< dev.name);
 			cerr <<endl;
-			ChangeDump( pllist );
+			if( !failed )
+				covfile.open("coverif.out");
+			failed = true;
+			ChangeDump( covfile, dev );
 		}
 	}
 }
 
 /////////////////////////////////////////////////////////
-// Dump logs on the err output. Used when co-verification
+// Dump logs on coverif.out. Used when co-verification
 // finds inconsistencies between two models
 /////////////////////////////////////////////////////////
-void ChangeDump( struct dev_loglist *pllist ) {
+void ChangeDump( ofstream &covfile, dev_state &dev ) {
 
-  log_list::iterator itor;
-	ofstream covfile;
-    
-	covfile.open("coverif.out");
-  if(  pllist->ref_log.size() ){
-		covfile <<endl << endl;
-    covfile << "**************** ArchC Change log *****************\n";
-    covfile << "* Reference Model         Device: "<< pllist->name << endl;
-    covfile << "***************************************************\n";
-    covfile << "*        Address         Value          Time      *\n";
-    covfile << "***************************************************\n";
-      
-    for( itor = pllist->ref_log.begin(); itor != pllist->ref_log.end(); itor++)  
-      covfile << "*  " << *itor << "     *" << endl;
-      
-    covfile << "***************************************************\n";
-  }
+	const char *what = checkpoint ? "Window" : "Address";
 
-  if(  pllist->duv_log.size() ){
+	covfile.fill(' ');
+  if(  dev.mismatches.size() ){
 		covfile <<endl << endl;
-    covfile << "**************** ArchC Change log *****************\n";
-    covfile << "* DUV Model         Device: "<< pllist->name << endl;
+    covfile << "**************** ArchC Mismatches *****************\n";
+    covfile << "* Device: "<< dev.name << endl;
+		if( checkpoint )
+			covfile << "* Windows of " << checkpoint << " updates: hash and update count\n";
     covfile << "***************************************************\n";
-    covfile << "*        Address         Value          Time      *\n";
+    covfile << "*        " << what << "       Reference        DUV     *\n";
     covfile << "***************************************************\n";
-      
-    for( itor = pllist->duv_log.begin(); itor != pllist->duv_log.end(); itor++)  
-      covfile << "*  " << *itor << "     *" << endl;
-      
+
+    for (unsigned i = 0; i < dev.mismatches.size(); i++) {
+			log_mismatch &m = dev.mismatches[i];
+      covfile << "*  " << setw(10) << hex << m.addr
+			        << "    " << setw(10) << m.ref.value << "    " << setw(10) << m.duv.value
+			        << dec << "     *" << endl;
+      covfile << "*  " << setw(10) << ""
+			        << "    " << setw(10) << m.ref.time << "    " << setw(10) << m.duv.time
+			        << "     *" << endl;
+		}
+
     covfile << "***************************************************\n";
   }
 
-	covfile.close();
+  for (int model = REFERENCE_MODEL; model <= DUV_MODEL; model++) {
+
+		bool header = false;
+
+		for (unordered_map<uint32_t, pending_updates>::iterator itor = dev.pending.begin();
+		     itor != dev.pending.end(); itor++) {
+
+			pending_updates &p = itor->second;
+			if( p.model != model )
+				continue;
+
+			if( !header ){
+				covfile <<endl << endl;
+				covfile << "**************** ArchC Change log *****************\n";
+				covfile << "* " << model_name[model] << " Model         Device: "<< dev.name << endl;
+				covfile << "***************************************************\n";
+				covfile << "*        Address         Value          Time      *\n";
+				covfile << "***************************************************\n";
+				header = true;
+			}
+
+			for (unsigned i = p.first; i < p.updates.size(); i++)
+				covfile << "*    " << setw(10) << hex << itor->first
+				        << "    " << setw(10) << p.updates[i].value
+				        << "    " << setw(12) << dec << p.updates[i].time << "     *" << endl;
+		}
+
+		if( dev.windows.size() && dev.windows_model == model ){
+			covfile <<endl << endl;
+			covfile << "**************** ArchC Windows ********************\n";
+			covfile << "* " << model_name[model] << " Model         Device: "<< dev.name << endl;
+			covfile << "***************************************************\n";
+			covfile << "*        Window          Hash           Updates   *\n";
+			covfile << "***************************************************\n";
+			for (unsigned i = 0; i < dev.windows.size(); i++)
+				covfile << "*    " << setw(10) << hex << dev.windows[i].addr
+				        << "    " << setw(10) << dev.windows[i].value
+				        << "    " << setw(12) << dec << dev.windows[i].time << "     *" << endl;
+			header = true;
+		}
+
+		if( header )
+			covfile << "***************************************************\n";
+  }
 }
 
 /////////////////////////////////////////////////////////
-// Check if both models were generated with the correct 
+// Check if both models were generated with the correct
 // command-line options. For now, the only obligatory
 // option is -v
 /////////////////////////////////////////////////////////
@@ -869,8 +854,8 @@ void CheckOptions( int model ) {
 
 	ifstream input;
   string read;
-	char *filename;
-	char* p;
+	const char *filename;
+	const char* p;
 
 	if(model == REFERENCE_MODEL)
 		filename = "refout.tmp";
@@ -884,16 +869,16 @@ void CheckOptions( int model ) {
     AC_ERROR("Command-line option checker aborted.");
     exit(1);
   }
-		
+
 	getline(input, read);
 	p = strstr( read.c_str(), "(");
 	if(p ){
-		
+
 		if( strstr( p, "-v") ||strstr( p, "-v)") )
 			return;
 	}
 
-	//If we got here, the command-line options were incorrect.	
+	//If we got here, the command-line options were incorrect.
 	if(model == REFERENCE_MODEL)
 		AC_ERROR("Reference Model is not prepared for co-verification.\n");
 	else
@@ -901,5 +886,5 @@ void CheckOptions( int model ) {
 
 	AC_MSG("   Run acpp with the -v option for generating models on co-verification mode");
 	exit(1);
-				
+
 }